@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+编译时从完整的ascii点阵字体生成界面用到的字体子集
+
+- 每个字符按1bpp逐行连续存放，行之间不补齐
+- 只保留指定的字符，没有的字符显示为背景色
+- 大字体可以用rle压缩，按字符记录起始位置，解码时直接写入行缓冲
+
+用法: gen_fonts.py --src fonts_ascii.inc --out-c fonts.c --out-h fonts_gen.h
+      [--rle-min-height 20] Font_7x10=" 0123" Font_16x26=" 0123\\xb0" ...
+字符集中可以用\\xNN表示非ascii字符
+"""
+
+import argparse
+import codecs
+import re
+import sys
+
+FIRST_CHAR = 32
+# 半字节rle，每个字节是背景和前景的长度，各0~15
+RLE_MAX_RUN = 15
+
+
+def parse_source(path):
+    text = open(path, encoding='utf-8', errors='replace').read()
+    tables = {}
+    for m in re.finditer(r'static const uint16_t (\w+)\s*\[\]\s*=\s*\{(.*?)\};', text, re.S):
+        body = re.sub(r'//[^\n]*', '', m.group(2))
+        tables[m.group(1)] = [int(v, 16) for v in re.findall(r'0x[0-9A-Fa-f]+', body)]
+    fonts = {}
+    for m in re.finditer(r'FontDef (\w+)\s*=\s*\{\s*(\d+)\s*,\s*(\d+)\s*,\s*(\w+)\s*\}', text):
+        name, w, h, table = m.group(1), int(m.group(2)), int(m.group(3)), m.group(4)
+        fonts[name] = (w, h, tables[table])
+    return fonts
+
+
+def glyph_bits(rows, w):
+    bits = []
+    for row in rows:
+        for x in range(w):
+            bits.append((row >> (15 - x)) & 1)
+    return bits
+
+
+def pack_bits(bits):
+    out = bytearray((len(bits) + 7) // 8)
+    for i, b in enumerate(bits):
+        if b:
+            out[i // 8] |= 0x80 >> (i % 8)
+    return bytes(out)
+
+
+def rle_encode(bits):
+    # 背景和前景的长度交替出现，超过15时插入长度为0的另一种颜色
+    runs = []
+    color, i = 0, 0
+    while i < len(bits):
+        n = 0
+        while i < len(bits) and bits[i] == color and n < RLE_MAX_RUN:
+            n += 1
+            i += 1
+        runs.append(n)
+        color ^= 1
+    if len(runs) % 2:
+        runs.append(0)
+    return bytes((runs[k] << 4) | runs[k + 1] for k in range(0, len(runs), 2))
+
+
+def gen_font(name, w, h, table, chars, rle_min_height):
+    count = len(table) // h
+    glyphs = []
+    for ch in sorted(set(chars)):
+        idx = ch - FIRST_CHAR
+        if idx < 0 or idx >= count:
+            sys.exit('%s: no glyph for 0x%02x' % (name, ch))
+        glyphs.append((ch, glyph_bits(table[idx * h:(idx + 1) * h], w)))
+
+    packed = [pack_bits(bits) for _, bits in glyphs]
+    rle = [rle_encode(bits) for _, bits in glyphs]
+    packed_size = sum(len(g) for g in packed)
+    # 压缩后要加上每个字符2字节的起始位置
+    rle_size = sum(len(g) for g in rle) + 2 * len(glyphs)
+    use_rle = h >= rle_min_height and rle_size < packed_size
+    data = rle if use_rle else packed
+
+    lines = []
+    ident = name.lower()
+    lines.append('// %s: %d个字符，%s %d字节（完整字体%d字节）' %
+                 (name, len(glyphs), 'rle' if use_rle else '1bpp',
+                  rle_size if use_rle else packed_size, len(table) * 2))
+    lines.append('static const uint8_t %s_chars[] = {%s};' %
+                 (ident, ', '.join('0x%02x' % ch for ch, _ in glyphs)))
+    lines.append('static const uint8_t %s_data[] = {' % ident)
+    for (ch, _), g in zip(glyphs, data):
+        lines.append('\t%s // %s' % (''.join('0x%02x, ' % b for b in g).rstrip(),
+                                    repr(chr(ch)) if ch < 0x7f else '0x%02x' % ch))
+    lines.append('};')
+    offsets = 'NULL'
+    if use_rle:
+        pos, offs = 0, []
+        for g in data:
+            offs.append(pos)
+            pos += len(g)
+        lines.append('static const uint16_t %s_offsets[] = {%s};' %
+                     (ident, ', '.join(str(o) for o in offs)))
+        offsets = '%s_offsets' % ident
+    lines.append('const FontDef %s = {%d, %d, %d, %s_chars, %s_data, %s};' %
+                 (name, w, h, len(glyphs), ident, ident, offsets))
+    return '\n'.join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--src', required=True)
+    parser.add_argument('--out-c', required=True)
+    parser.add_argument('--out-h', required=True)
+    parser.add_argument('--rle-min-height', type=int, default=20)
+    parser.add_argument('subsets', nargs='+', help='Font_WxH=chars')
+    args = parser.parse_args()
+
+    fonts = parse_source(args.src)
+    c_parts = ['/* 由scripts/gen_fonts.py生成，不要修改 */',
+               '#include <stddef.h>', '#include "fonts.h"', '']
+    h_parts = ['/* 由scripts/gen_fonts.py生成，不要修改 */',
+               '#ifndef __FONTS_GEN_H__', '#define __FONTS_GEN_H__', '']
+    for spec in args.subsets:
+        name, _, chars = spec.partition('=')
+        if name not in fonts:
+            sys.exit('unknown font %s' % name)
+        chars = codecs.decode(chars, 'unicode_escape').encode('latin-1')
+        w, h, table = fonts[name]
+        c_parts.append(gen_font(name, w, h, table, chars, args.rle_min_height))
+        c_parts.append('')
+        h_parts.append('extern const FontDef %s;' % name)
+    h_parts += ['', '#endif // __FONTS_GEN_H__', '']
+
+    with open(args.out_c, 'w') as f:
+        f.write('\n'.join(c_parts))
+    with open(args.out_h, 'w') as f:
+        f.write('\n'.join(h_parts))
+
+
+if __name__ == '__main__':
+    main()
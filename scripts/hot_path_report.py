@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""
+编译后输出控制环路热路径函数/数据所在的存储区域和大小
+
+用法: hot_path_report.py --nm <nm> --elf zephyr.elf --ccm-addr 0x10000000 --ccm-size 10240
+      [--out report.txt] [--ccm-budget 8192] symbol...
+CCM总占用超过--ccm-budget时返回错误，编译失败
+"""
+
+import argparse
+import subprocess
+import sys
+
+
+def load_symbols(nm, elf):
+    out = subprocess.run([nm, '-S', '--defined-only', elf], check=True,
+                         capture_output=True, text=True).stdout
+    syms = {}
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) != 4:
+            continue
+        addr, size, kind, name = parts
+        syms.setdefault(name, []).append((int(addr, 16), int(size, 16), kind))
+    return syms
+
+
+def region_of(addr, ccm_addr, ccm_size):
+    if ccm_addr <= addr < ccm_addr + ccm_size:
+        return 'CCM'
+    if addr >= 0x20000000:
+        return 'SRAM'
+    return 'FLASH'
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--nm', required=True)
+    parser.add_argument('--elf', required=True)
+    parser.add_argument('--ccm-addr', type=lambda x: int(x, 0), default=0x10000000)
+    parser.add_argument('--ccm-size', type=lambda x: int(x, 0), default=0)
+    parser.add_argument('--out')
+    parser.add_argument('--ccm-budget', type=lambda x: int(x, 0))
+    parser.add_argument('symbols', nargs='*')
+    args = parser.parse_args()
+
+    syms = load_symbols(args.nm, args.elf)
+    lines = ['Hot path placement:']
+    lines.append('  %-34s %-10s %6s  %s' % ('symbol', 'address', 'size', 'region'))
+    for name in args.symbols:
+        if name not in syms:
+            lines.append('  %-34s %-10s %6s  %s' % (name, '-', '-', 'inlined'))
+            continue
+        for addr, size, _ in syms[name]:
+            lines.append('  %-34s 0x%08x %6d  %s' % (
+                name, addr, size, region_of(addr & ~1, args.ccm_addr, args.ccm_size)))
+
+    # CCM总占用，代码和数据分开统计
+    text = data = 0
+    for entries in syms.values():
+        for addr, size, kind in entries:
+            if region_of(addr & ~1, args.ccm_addr, args.ccm_size) != 'CCM':
+                continue
+            if kind in 'tT':
+                text += size
+            else:
+                data += size
+    lines.append('CCM usage: text %d B, data/bss %d B, total %d / %d B' % (
+        text, data, text + data, args.ccm_size))
+
+    report = '\n'.join(lines) + '\n'
+    sys.stdout.write(report)
+    if args.out:
+        with open(args.out, 'w') as f:
+            f.write(report)
+    if args.ccm_budget is not None and text + data > args.ccm_budget:
+        sys.stderr.write('error: CCM usage %d B exceeds budget %d B\n' % (
+            text + data, args.ccm_budget))
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
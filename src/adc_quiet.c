@@ -0,0 +1,139 @@
+#include <zephyr/kernel.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/logging/log.h>
+
+#include "adc_quiet.h"
+#include "service.h"
+
+LOG_MODULE_REGISTER(adc_quiet, LOG_LEVEL_INF);
+
+// 屏幕spi的最高频率，实际是分频后不超过该值的频率
+#define DISPLAY_SPI_HZ DT_PROP(DT_CHOSEN(zephyr_display), mipi_max_frequency)
+// 每次传输设置窗口地址等命令的时间
+#define XFER_SETUP_US  50
+// 传输结束到采样窗口开始至少留出的时间
+#define GUARD_US       100
+// 最长等待时间，采样停止或者窗口一直没结束时不再等待
+#define MAX_WAIT_US    (20 * 1000)
+
+// 统计信息输出周期
+#define ADC_QUIET_STATS_PERIOD_MS (60 * 1000)
+
+static struct k_spinlock lock;
+static K_SEM_DEFINE(quiet_sem, 0, 1);
+
+static bool window_active;
+static bool xfer_active;
+static uint32_t window_start_cyc;
+static uint32_t next_window_cyc;
+
+// 统计
+static uint32_t windows;
+static uint32_t overlaps;      // 采样窗口开始时还在传输
+static uint32_t deferred;      // 等待后才开始的传输
+static uint32_t timeouts;      // 等待超时直接开始的传输
+static uint32_t max_window_us;
+static uint32_t max_wait_us;
+
+void adc_quiet_begin(uint32_t next_us)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	window_active = true;
+	window_start_cyc = k_cycle_get_32();
+	next_window_cyc = window_start_cyc + k_us_to_cyc_ceil32(next_us);
+	windows++;
+	if (xfer_active) {
+		overlaps++;
+	}
+	k_spin_unlock(&lock, key);
+}
+
+void adc_quiet_end(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	if (window_active) {
+		uint32_t us = k_cyc_to_us_ceil32(k_cycle_get_32() - window_start_cyc);
+
+		window_active = false;
+		max_window_us = MAX(max_window_us, us);
+	}
+	k_spin_unlock(&lock, key);
+	k_sem_give(&quiet_sem);
+}
+
+static uint32_t xfer_us(size_t bytes)
+{
+	uint32_t us = (uint64_t)bytes * 8 * USEC_PER_SEC / DISPLAY_SPI_HZ;
+
+	// 实际spi频率低于最高频率，多留1/8
+	return us + us / 8 + XFER_SETUP_US;
+}
+
+void adc_quiet_xfer_begin(size_t bytes)
+{
+	uint32_t need_cyc = k_us_to_cyc_ceil32(xfer_us(bytes) + GUARD_US);
+	uint32_t start = k_cycle_get_32();
+	bool waited = false;
+
+	while (true) {
+		// 先清掉旧的信号，检查状态后窗口才结束时sem_take会直接返回
+		k_sem_reset(&quiet_sem);
+
+		k_spinlock_key_t key = k_spin_lock(&lock);
+		uint32_t now = k_cycle_get_32();
+		int32_t until = (int32_t)(next_window_cyc - now);
+		uint32_t waited_us = k_cyc_to_us_ceil32(now - start);
+
+		// until小于0说明采样已经停止，不用等
+		if (!window_active && (until < 0 || (uint32_t)until >= need_cyc)) {
+			xfer_active = true;
+			if (waited) {
+				deferred++;
+				max_wait_us = MAX(max_wait_us, waited_us);
+			}
+			k_spin_unlock(&lock, key);
+			return;
+		}
+		if (waited_us >= MAX_WAIT_US) {
+			xfer_active = true;
+			timeouts++;
+			k_spin_unlock(&lock, key);
+			return;
+		}
+		// 窗口还没开始时，最多等到窗口开始后再过最长窗口时间
+		uint32_t wait_us = window_active ? MAX_WAIT_US - waited_us
+						 : k_cyc_to_us_ceil32(until) + max_window_us;
+		k_spin_unlock(&lock, key);
+
+		waited = true;
+		k_sem_take(&quiet_sem, K_USEC(MIN(wait_us, MAX_WAIT_US - waited_us)));
+	}
+}
+
+void adc_quiet_xfer_end(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	xfer_active = false;
+	k_spin_unlock(&lock, key);
+}
+
+void adc_quiet_log_stats(void)
+{
+	LOG_INF("adc windows %u max %u us, spi deferred %u max wait %u us, overlaps %u timeouts %u",
+		windows, max_window_us, deferred, max_wait_us, overlaps, timeouts);
+}
+
+static void stats_handler(struct service_job *job)
+{
+	adc_quiet_log_stats();
+}
+
+static struct service_job stats_job = SERVICE_JOB_INITIALIZER("adc quiet stats", stats_handler);
+
+void adc_quiet_init(void)
+{
+	service_add(&stats_job, ADC_QUIET_STATS_PERIOD_MS, ADC_QUIET_STATS_PERIOD_MS);
+}
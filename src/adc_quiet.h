@@ -0,0 +1,44 @@
+#ifndef __ADC_QUIET_H
+#define __ADC_QUIET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * 烙铁头热电偶采样窗口和屏幕spi传输的协调：
+ * 从关闭pwm开始到adc转换结束为采样窗口，期间不开始新的spi传输；
+ * 按下一次采样的时间估计传输能否在窗口开始前完成，来不及就等到窗口结束后再传输。
+ */
+
+/**
+ * @brief 采样窗口开始，在采样定时器中断里调用
+ * @param next_us 到下一个采样窗口开始的时间
+ */
+void adc_quiet_begin(uint32_t next_us);
+
+/**
+ * @brief adc转换结束，采样窗口关闭
+ */
+void adc_quiet_end(void);
+
+/**
+ * @brief 开始传输bytes字节前调用，需要时等待采样窗口结束，不能在中断里调用
+ */
+void adc_quiet_xfer_begin(size_t bytes);
+
+/**
+ * @brief 传输结束
+ */
+void adc_quiet_xfer_end(void);
+
+/**
+ * @brief 注册周期统计输出
+ */
+void adc_quiet_init(void);
+
+/**
+ * @brief 输出采样窗口长度、推迟的传输次数和仍然重叠的次数
+ */
+void adc_quiet_log_stats(void);
+
+#endif // __ADC_QUIET_H
@@ -9,11 +9,13 @@
 #include <zephyr/drivers/sensor.h>
 #include <zephyr/drivers/usb_c/usbc_pd.h>
 #include <zephyr/kernel.h>
+#include <zephyr/pm/device_runtime.h>
 #include <zephyr/smf.h>
 #include <zephyr/sys/atomic.h>
 #include <zephyr/sys/printk.h>
 #include <zephyr/sys_clock.h>
 #include <zephyr/sys/util.h>
+#include <zephyr/sys/byteorder.h>
 
 #include "app_ui.h"
 #include "tft/canvas.h"
@@ -22,11 +24,36 @@
 
 #include "usb_pd.h"
 #include "temperature_adc.h"
+#include "trend.h"
+#include "i2c_bus.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(main, LOG_LEVEL_DBG);
 
 #define FPS 10
+// ina226电压、功率刷新周期
+#define INA226_PERIOD_MS 100
+
+#if defined(CONFIG_UI_TREND)
+// 主界面温度文字和趋势图之间，右侧显示设定温度、电压和功率
+#define MAIN_TEMP_X  0
+#define MAIN_TEXT_X  108
+// 趋势图区域，从左往右扫描，每个降采样点只写一列
+#define TREND_X      52
+#define TREND_W      52
+#define TREND_H      40
+// 显示目标温度以上20℃、以下60℃，每行2℃
+#define TREND_ABOVE_C   20
+#define TREND_C_PER_ROW 2
+#define TREND_TEMP_COLOR     COLOR_YELLOW
+#define TREND_SETPOINT_COLOR COLOR_RGB565(0, 160, 0)
+#define TREND_POWER_COLOR    COLOR_RGB565(96, 0, 0)
+
+BUILD_ASSERT(TREND_HISTORY > TREND_W, "trend history shorter than the plot");
+#else
+#define MAIN_TEMP_X  10
+#define MAIN_TEXT_X  100
+#endif
 
 static void ui_set_state(struct app *app, const enum ui_state state);
 
@@ -43,6 +70,13 @@ static void display_init(void)
 		LOG_ERR("DISPLAY device not ready");
 		return;
 	}
+	// 由运行时电源管理控制，深度睡眠时挂起
+	if (pm_device_runtime_enable(display_dev) == 0) {
+		pm_device_runtime_get(display_dev);
+	}
+	if (pm_device_runtime_enable(ina226_dev) == 0) {
+		pm_device_runtime_get(ina226_dev);
+	}
 
 	display_blanking_off(display_dev);
 	display_set_orientation(display_dev, DISPLAY_ORIENTATION_ROTATED_90);
@@ -53,62 +87,212 @@ static void display_init(void)
 }
 
 
+/*
+ * ina226读取提交到i2c总线调度，一次事务连续读总线电压和电流寄存器，
+ * 功率由两者相乘，不再单独读功率寄存器
+ */
+#define INA226_REG_BUS_VOLTAGE 0x02
+#define INA226_REG_CURRENT     0x04
+#define INA226_BUS_UV_PER_LSB  1250
+#define INA226_CURRENT_LSB_UA  DT_PROP(DT_ALIAS(ina226), current_lsb_microamps)
+
+I2C_DT_IODEV_DEFINE(ina226_iodev, DT_ALIAS(ina226));
+
+static uint8_t ina226_regs[] = {INA226_REG_BUS_VOLTAGE, INA226_REG_CURRENT};
+static uint8_t ina226_bus_buf[2];
+static uint8_t ina226_current_buf[2];
+static struct i2c_msg ina226_msgs[] = {
+	{.buf = &ina226_regs[0], .len = 1, .flags = I2C_MSG_WRITE},
+	{.buf = ina226_bus_buf, .len = 2, .flags = I2C_MSG_RESTART | I2C_MSG_READ},
+	{.buf = &ina226_regs[1], .len = 1, .flags = I2C_MSG_RESTART | I2C_MSG_WRITE},
+	{.buf = ina226_current_buf, .len = 2, .flags = I2C_MSG_RESTART | I2C_MSG_READ | I2C_MSG_STOP},
+};
+
+// 在i2c总线线程中执行
+static void ina226_done(struct i2c_bus_req *req, int result)
+{
+	struct app *app = CONTAINER_OF(req, struct app, ina_req);
+
+	if (result < 0 || app->tip_ctrl == NULL) {
+		return;
+	}
+	int32_t mv = sys_get_be16(ina226_bus_buf) * INA226_BUS_UV_PER_LSB / 1000;
+	int32_t ma = (int16_t)sys_get_be16(ina226_current_buf) * INA226_CURRENT_LSB_UA / 1000;
+
+	// 加热功率估计和功率内环需要电压、功率
+	app->tip_ctrl->ina_vbus_mv = mv;
+	app->tip_ctrl->vbus_mv = mv;
+	app->tip_ctrl->ina_power_mw = MAX(mv * ma / 1000, 0);
+	app->tip_ctrl->ina_fresh = true;
+	app->tip_ctrl->ina_seq++;
+}
+
 static void sample_fetch(struct app *app)
 {
-	sensor_sample_fetch_chan(ina226_dev, SENSOR_CHAN_ALL);
+	// 上一次还没完成时跳过
+	i2c_bus_submit(&app->ina_req);
 }
 
+#if defined(CONFIG_UI_TREND)
+static int trend_row(const struct app *app, int32_t temp_x10)
+{
+	int32_t row = (app->trend_top_c * 10 - temp_x10) / (TREND_C_PER_ROW * 10);
+
+	return CLAMP(row, 0, TREND_H - 1);
+}
+
+// 画第n个点所在的列，cursor为真时同时清除下一列，作为扫描位置标记
+static void trend_draw_column(struct app *app, uint32_t n, bool cursor)
+{
+	uint16_t pixels[TREND_H * 2];
+	struct trend_point pt = trend_get(n);
+	uint16_t col = n % TREND_W;
+	uint16_t w = cursor && col < TREND_W - 1 ? 2 : 1;
+	int row = trend_row(app, pt.temp_x10);
+	// 和上一个点连成竖线，温度变化快时曲线不断开
+	int prev = n > 0 ? trend_row(app, trend_get(n - 1).temp_x10) : row;
+	int sp_row = trend_row(app, pt.setpoint * 10);
+	int power_rows = (pt.power * TREND_H + 127) / 255;
+
+	for (int y = 0; y < TREND_H; y++) {
+		uint16_t color = y >= TREND_H - power_rows ? TREND_POWER_COLOR : COLOR_BLACK;
+
+		if (y == sp_row) {
+			color = TREND_SETPOINT_COLOR;
+		}
+		if (y >= MIN(prev, row) && y <= MAX(prev, row)) {
+			color = TREND_TEMP_COLOR;
+		}
+		pixels[y * w] = color;
+		if (w == 2) {
+			pixels[y * w + 1] = COLOR_BLACK;
+		}
+	}
+	draw_pixels(display_dev, TREND_X + col, 0, w, TREND_H, pixels);
+}
+
+/*
+ * 只画新增加的点，每个点一列；目标温度变化（包括休眠）或清屏后纵向范围改变，
+ * 按新范围重画整个图
+ */
+static void main_draw_trend(struct app *app)
+{
+	uint32_t seq = trend_seq();
+	uint32_t from = app->trend_drawn;
+
+	if (seq == 0) {
+		return;
+	}
+	int16_t top = trend_get(seq - 1).setpoint + TREND_ABOVE_C;
+	if (top != app->trend_top_c || seq - from >= TREND_W) {
+		app->trend_top_c = top;
+		from = seq > TREND_W - 1 ? seq - (TREND_W - 1) : 0;
+	}
+	for (uint32_t n = from; n < seq; n++) {
+		trend_draw_column(app, n, n == seq - 1);
+	}
+	app->trend_drawn = seq;
+}
+#endif
+
 static void main_entry(void *obj)
 {
 	struct app *app = (struct app *)obj;
 	app->tip_ctrl->heater_on = true;
+#if defined(CONFIG_TIP_PREHEAT)
+	tip_preheat_end();
+#endif
+	// 按键直接调整设定温度
+	atomic_set(&app->setpoint_input, 1);
+}
+
+static void main_exit(void *obj)
+{
+	struct app *app = (struct app *)obj;
+
+	atomic_set(&app->setpoint_input, 0);
 }
 
 static void main_event(struct app *app, const enum event evt)
 {
+	// 一般由按键上报上下文直接调整，切换界面的瞬间才会进入这里
 	if (evt == EVT_UP) {
-		app->tip_ctrl->setpoint += 10.0f;
+		tip_adjust_setpoint(10);
 	} else if (evt == EVT_DOWN) {
-		app->tip_ctrl->setpoint -= 10.0f;
+		tip_adjust_setpoint(-10);
 	} else if (evt == EVT_OK) {
 		ui_set_state(app, UI_PREVIEW);
-		app->req.val = FULL_SCREEN;
+		app->redraw = FULL_SCREEN;
 	}
 }
 
+// 多个故障时显示最需要处理的一个
+static const char *fault_label(uint8_t fault)
+{
+	if (fault & TIP_FAULT_REMOVED) {
+		return "NO TIP";
+	}
+	if (fault & TIP_FAULT_HEATER) {
+		return "HEATER";
+	}
+	if (fault & (TIP_FAULT_ADC | TIP_FAULT_STUCK)) {
+		return "ADC";
+	}
+	return "SLEW";
+}
+
 static enum smf_state_result main_draw(void *obj)
 {
 	struct app *app = (struct app *)obj;
 	char buf[32];
-	struct sensor_value val;
+	uint8_t fault = app->tip_ctrl->fault.active;
+	uint16_t color;
 
-	sample_fetch(app);
+	if (fault != 0) {
+		// 温度不可信，不显示数值
+		snprintf(buf, sizeof(buf), "---");
+		color = COLOR_RED;
+	} else {
+#if defined(CONFIG_UI_TREND)
+		// 趋势图占用了单位的位置
+		snprintf(buf, sizeof(buf), "%3d", (int32_t)app->tip_ctrl->cur_temp);
+#else
+		snprintf(buf, sizeof(buf),
+			 "%3d\xb0"
+			 "C",
+			 (int32_t)app->tip_ctrl->cur_temp);
+#endif
+		color = app->tip_ctrl->is_sleeping ? COLOR_GREEN : COLOR_YELLOW;
+	}
+	draw_text(display_dev, buf, MAIN_TEMP_X, 7, Font_16x26, color, COLOR_BLACK);
 
-	snprintf(buf, sizeof(buf),
-		 "%3d\xb0"
-		 "C",
-		 (int32_t)app->tip_ctrl->cur_temp);
-	draw_text(display_dev, buf, 10, 7, Font_16x26,
-		  app->tip_ctrl->is_sleeping ? COLOR_GREEN : COLOR_YELLOW, COLOR_BLACK);
-
-	int8_t x_off = 100;
+	int8_t x_off = MAIN_TEXT_X;
 
 	int8_t y_off = 2;
-	snprintf(buf, sizeof(buf), "SET:%03d", (int32_t)app->tip_ctrl->setpoint);
-	draw_text(display_dev, buf, x_off, y_off, Font_7x10, COLOR_YELLOW, COLOR_BLACK);
+	if (fault != 0) {
+		// 设定温度的位置显示故障
+		snprintf(buf, sizeof(buf), "%-7s", fault_label(fault));
+	} else {
+		snprintf(buf, sizeof(buf), "SET:%03d", (int32_t)app->tip_ctrl->setpoint);
+	}
+	draw_text(display_dev, buf, x_off, y_off, Font_7x10, fault != 0 ? COLOR_RED : COLOR_YELLOW,
+		  COLOR_BLACK);
 
-	sensor_channel_get(ina226_dev, SENSOR_CHAN_VOLTAGE, &val);
+	uint16_t mv = app->tip_ctrl->ina_vbus_mv;
 	y_off += 10 + 4;
-	snprintf(buf, sizeof(buf), "U:%2d.%1dV", val.val1, (val.val2 / 100000) % 10);
+	snprintf(buf, sizeof(buf), "U:%2d.%1dV", mv / 1000, (mv / 100) % 10);
 	draw_text(display_dev, buf, x_off, y_off, Font_7x10, COLOR_WHITE, COLOR_BLACK);
 
-	sensor_channel_get(ina226_dev, SENSOR_CHAN_POWER, &val);
+	uint32_t mw = app->tip_ctrl->ina_power_mw;
 	y_off += 10 + 4;
-	snprintf(buf, sizeof(buf), "P:%2d.%1dW", val.val1, (val.val2 / 100000) % 10);
+	snprintf(buf, sizeof(buf), "P:%2d.%1dW", mw / 1000, (mw / 100) % 10);
 	draw_text(display_dev, buf, x_off, y_off, Font_7x10, COLOR_RED, COLOR_BLACK);
 
 	// snprintf(buf, sizeof(buf), "%-5s", app->tip_ctrl->is_sleeping ? "sleep" : "run");
 	// draw_text(display_dev, buf, x_off - 40, y_off, Font_7x10, COLOR_GREEN, COLOR_BLACK);
+#if defined(CONFIG_UI_TREND)
+	main_draw_trend(app);
+#endif
 	return SMF_EVENT_HANDLED;
 }
 
@@ -126,19 +310,28 @@ static enum smf_state_result pid_tuning_draw(void *obj)
 	int8_t x_off = 100;
 
 	int8_t y_off = 2;
-	snprintf(buf, sizeof(buf), "Kp:%03d", (int32_t)(pid_get_kp(&app->tip_ctrl->pid) * 100));
+	float kp, ki, kd;
+
+	// 显示可以调整的增益表中的值
+	tip_get_hold_gains(&kp, &ki, &kd);
+	snprintf(buf, sizeof(buf), "Kp:%03d", (int32_t)(kp * 100));
 	draw_text(display_dev, buf, x_off, y_off, Font_7x10, COLOR_YELLOW, COLOR_BLACK);
 
 	y_off += 10 + 3;
-	snprintf(buf, sizeof(buf), "Ki:%03d", (int32_t)(pid_get_ki(&app->tip_ctrl->pid) * 100));
+	snprintf(buf, sizeof(buf), "Ki:%03d", (int32_t)(ki * 100));
 	draw_text(display_dev, buf, x_off, y_off, Font_7x10, COLOR_WHITE, COLOR_BLACK);
 
 	y_off += 10 + 3;
-	snprintf(buf, sizeof(buf), "Kd:%03d", (int32_t)(pid_get_kd(&app->tip_ctrl->pid) * 100));
+	snprintf(buf, sizeof(buf), "Kd:%03d", (int32_t)(kd * 100));
 	draw_text(display_dev, buf, x_off, y_off, Font_7x10, COLOR_RED, COLOR_BLACK);
 
 	snprintf(buf, sizeof(buf), "%d", app->p_adj);
 	draw_text(display_dev, buf, 80, 25, Font_7x10, COLOR_YELLOW, COLOR_BLACK);
+
+	// mosfet关断稳定时间(us)
+	snprintf(buf, sizeof(buf), "%4d", app->tip_ctrl->settle_us);
+	draw_text(display_dev, buf, 62, 2, Font_7x10,
+		  app->tip_ctrl->settle_pending ? COLOR_RED : COLOR_GREEN, COLOR_BLACK);
 	return SMF_EVENT_HANDLED;
 }
 
@@ -146,7 +339,7 @@ static void pid_tuning_event(struct app *app, const enum event evt)
 {
 	if (evt == EVT_OK) { // 切换pid调整的参数类型
 		enum pid_adj adj = app->p_adj;
-		if (adj < ADJ_KD) {
+		if (adj < ADJ_SETTLE) {
 			adj++;
 		} else {
 			adj = ADJ_KP;
@@ -154,9 +347,9 @@ static void pid_tuning_event(struct app *app, const enum event evt)
 		app->p_adj = adj;
 		return;
 	}
-	float kp = pid_get_kp(&app->tip_ctrl->pid);
-	float ki = pid_get_ki(&app->tip_ctrl->pid);
-	float kd = pid_get_kd(&app->tip_ctrl->pid);
+	float kp, ki, kd;
+
+	tip_get_hold_gains(&kp, &ki, &kd);
 
 	switch (app->p_adj) {
 	case ADJ_KP:
@@ -181,8 +374,13 @@ static void pid_tuning_event(struct app *app, const enum event evt)
 			kd -= 0.1f;
 		}
 		break;
+	case ADJ_SETTLE:
+		if (evt == EVT_UP) {
+			tip_request_settle_calibration();
+		}
+		return;
 	}
-	pid_set_tunings(&app->tip_ctrl->pid, kp, ki, kd);
+	tip_set_hold_gains(kp, ki, kd);
 }
 
 static void preview_entry(void *obj)
@@ -196,9 +394,6 @@ static enum smf_state_result preview_draw(void *obj)
 {
 	struct app *app = (struct app *)obj;
 	char buf[32];
-	struct sensor_value val;
-
-	sample_fetch(app);
 
 	int8_t x_off = 80;
 
@@ -207,8 +402,8 @@ static enum smf_state_result preview_draw(void *obj)
 	snprintf(buf, sizeof(buf), "%3d", (int32_t)app->tip_ctrl->cur_temp);
 	draw_text(display_dev, buf, 0, y_off, Font_7x10, COLOR_YELLOW, COLOR_BLACK);
 
-	sensor_channel_get(ina226_dev, SENSOR_CHAN_VOLTAGE, &val);
-	snprintf(buf, sizeof(buf), "VBUS:%2d.%1dV", val.val1, (val.val2 / 100000) % 10);
+	uint16_t mv = app->tip_ctrl->ina_vbus_mv;
+	snprintf(buf, sizeof(buf), "VBUS:%2d.%1dV", mv / 1000, (mv / 100) % 10);
 	draw_text(display_dev, buf, x_off, y_off, Font_7x10, COLOR_WHITE, COLOR_BLACK);
 	y_off += 18;
 
@@ -222,15 +417,12 @@ static enum event preview_event(struct app *app)
 {
 	enum event evt;
 	if (check_pd_ready(app->pd_data)) { // 检测pd请求是否已完成
-		sample_fetch(app);
-		struct sensor_value val;
-		sensor_channel_get(ina226_dev, SENSOR_CHAN_VOLTAGE, &val);
+		// ina226每100ms在总线线程中更新，这里不等待读取
+		int mv = app->tip_ctrl->ina_vbus_mv;
 
 		// 检测实际电压跟请求电压差不超过2V
-		if (abs(pd_get_requested_voltage(app->pd_data) -
-			(int)(sensor_value_to_double(&val) * 1000)) < 2000 &&
-		    (int)(sensor_value_to_double(&val) * 1000) >
-			    7000 // 这里随便加了7V保证请求的是9V以上档位
+		if (abs(pd_get_requested_voltage(app->pd_data) - mv) < 2000 &&
+		    mv > 7000 // 这里随便加了7V保证请求的是9V以上档位
 		) {
 			evt = EVT_HOME;
 		} else {
@@ -245,7 +437,7 @@ static enum event preview_event(struct app *app)
 }
 
 static const struct smf_state ui_states[UI_STATE_COUNT] = {
-	[UI_MAIN] = SMF_CREATE_STATE(main_entry, main_draw, NULL, NULL, NULL),
+	[UI_MAIN] = SMF_CREATE_STATE(main_entry, main_draw, main_exit, NULL, NULL),
 	[UI_PID_TUNING] = SMF_CREATE_STATE(pid_tuning_entry, pid_tuning_draw, NULL, NULL, NULL),
 	[UI_PREVIEW] = SMF_CREATE_STATE(preview_entry, preview_draw, NULL, NULL, NULL),
 };
@@ -260,11 +452,23 @@ static enum ui_state ui_get_current_state(struct app *app)
 	return app->ctx.current - &ui_states[0];
 }
 
-void app_init(struct app *app)
+static void draw_handler(struct service_job *job)
 {
+	app_draw(CONTAINER_OF(job, struct app, draw_job));
+}
 
-	display_init();
+static void ina226_handler(struct service_job *job)
+{
+	sample_fetch(CONTAINER_OF(job, struct app, ina_job));
+}
+
+static void fault_handler(struct service_job *job)
+{
+	app_event_handler(CONTAINER_OF(job, struct app, fault_job), EVT_FAULT);
+}
 
+void app_init(struct app *app)
+{
 	if (!device_is_ready(ina226_dev)) {
 		LOG_ERR("INA226 device not ready");
 		return;
@@ -273,35 +477,64 @@ void app_init(struct app *app)
 	memset(app, 0, sizeof(struct app));
 
 	k_mutex_init(&app->mutex);
-	app->last_time = k_uptime_get_32() + (1000 / FPS) * 2; // 保证第一次被刷新
+	app->draw_job = (struct service_job)SERVICE_JOB_INITIALIZER("draw", draw_handler);
+	app->ina_job = (struct service_job)SERVICE_JOB_INITIALIZER("ina226", ina226_handler);
+	app->fault_job = (struct service_job)SERVICE_JOB_INITIALIZER("tip fault", fault_handler);
+	app->ina_req = (struct i2c_bus_req){
+		.iodev = &ina226_iodev,
+		.msgs = ina226_msgs,
+		.num_msgs = ARRAY_SIZE(ina226_msgs),
+		.prio = I2C_BUS_PRIO_HIGH,
+		.done = ina226_done,
+	};
 
 	smf_set_initial(SMF_CTX(app), &ui_states[UI_PREVIEW]);
 }
 
+void app_display_init(struct app *app)
+{
+	display_init();
+
+	service_add(&app->draw_job, 0, 1000 / FPS);
+	service_add(&app->ina_job, 0, INA226_PERIOD_MS);
+	// 屏幕可以刷新后才通知故障
+	app->tip_ctrl->fault_job = &app->fault_job;
+}
+
+void app_display_suspend(struct app *app)
+{
+	service_remove(&app->draw_job);
+	service_remove(&app->ina_job);
+
+	gpio_pin_set_dt(&lcd_blk, 0);
+	display_blanking_on(display_dev);
+	pm_device_runtime_put(display_dev);
+	pm_device_runtime_put(ina226_dev);
+}
+
+void app_display_resume(struct app *app)
+{
+	pm_device_runtime_get(ina226_dev);
+	pm_device_runtime_get(display_dev);
+	display_blanking_off(display_dev);
+	gpio_pin_set_dt(&lcd_blk, 1);
+
+	app->redraw = FULL_SCREEN;
+	service_add(&app->draw_job, 0, 1000 / FPS);
+	service_add(&app->ina_job, 0, INA226_PERIOD_MS);
+}
+
 void app_draw(struct app *app)
 {
-	struct req_value *req;
 	if (k_mutex_lock(&app->mutex, K_FOREVER)) {
 		return;
 	}
 
-	// 控制帧数
-	int32_t delay = MIN((1000 / FPS) - (k_uptime_get_32() - app->last_time),
-			    2000); // 防止可能的时间溢出导致等待时间过长
-	k_timeout_t timeout;
-	if (delay <= 0) {
-		timeout = K_NO_WAIT;
-	} else {
-		timeout = K_MSEC(delay);
-	}
-
-	// 等待超时或者提前有事件发生，需要马上刷新界面
-	req = k_fifo_get(&app->req_fifo, timeout);
-
-	app->last_time = k_uptime_get_32(); // 从这里记录时间，把屏幕刷新所用时间计算进去
-
-	if (req != NULL && req->val == FULL_SCREEN) {
+	if (app->redraw == FULL_SCREEN) {
 		draw_fill_screen(display_dev, COLOR_BLACK);
+		app->redraw = NORMAL;
+		// 清屏后趋势图需要整个重画
+		app->trend_top_c = INT16_MIN;
 	}
 	smf_run_state(SMF_CTX(app));
 
@@ -314,9 +547,8 @@ void app_event_handler(struct app *app, enum event evt)
 		return;
 	}
 	enum ui_state state = ui_get_current_state(app);
-	app->req.val = NORMAL;
 	// 防止preview界面被反复进入
-	if (state == UI_PREVIEW && evt != EVT_ENTER_PREVIEW) {
+	if (state == UI_PREVIEW && evt != EVT_ENTER_PREVIEW && evt != EVT_FAULT) {
 		evt = preview_event(app); // 任意按键，检测pd电压是否达到要求
 	}
 	switch (evt) {
@@ -327,7 +559,7 @@ void app_event_handler(struct app *app, enum event evt)
 			state = UI_MAIN;
 		}
 		ui_set_state(app, state);
-		app->req.val = FULL_SCREEN;
+		app->redraw = FULL_SCREEN;
 		break;
 	}
 	case EVT_BACK: {
@@ -336,13 +568,13 @@ void app_event_handler(struct app *app, enum event evt)
 			state = UI_STATE_COUNT - 1; // 到最后界面
 		}
 		ui_set_state(app, state);
-		app->req.val = FULL_SCREEN;
+		app->redraw = FULL_SCREEN;
 		break;
 	}
 	case EVT_HOME: {
 		if (state != UI_MAIN) {
 			ui_set_state(app, UI_MAIN);
-			app->req.val = FULL_SCREEN;
+			app->redraw = FULL_SCREEN;
 		}
 		break;
 	}
@@ -359,7 +591,17 @@ void app_event_handler(struct app *app, enum event evt)
 	case EVT_ENTER_PREVIEW: {
 		if (state != UI_PREVIEW) {
 			ui_set_state(app, UI_PREVIEW);
-			app->req.val = FULL_SCREEN;
+			app->redraw = FULL_SCREEN;
+		}
+		break;
+	}
+	case EVT_FAULT: {
+		// 调试界面回到主界面显示故障，文字长度变化，需要清屏
+		if (state == UI_PID_TUNING) {
+			ui_set_state(app, UI_MAIN);
+		}
+		if (state != UI_PREVIEW) {
+			app->redraw = FULL_SCREEN;
 		}
 		break;
 	}
@@ -368,7 +610,7 @@ void app_event_handler(struct app *app, enum event evt)
 		break;
 	}
 	// 发生事件，马上刷新屏幕
-	k_fifo_put(&app->req_fifo, &app->req);
+	service_kick(&app->draw_job);
 
 	k_mutex_unlock(&app->mutex);
 }
@@ -8,6 +8,8 @@
 #include <zephyr/smf.h>
 
 #include "heater_controller.h"
+#include "service.h"
+#include "i2c_bus.h"
 
 
 enum event {
@@ -18,6 +20,7 @@ enum event {
 	EVT_BACK,
 	EVT_HOME,
 	EVT_ENTER_PREVIEW,
+	EVT_FAULT, // 烙铁头故障出现或清除
 	EVT_EMPTY,
 };
 
@@ -32,13 +35,7 @@ enum pid_adj{
     ADJ_KP,
     ADJ_KI,
     ADJ_KD,
-};
-
-struct req_value{
-	/** First word is reserved for use by FIFO */
-	void *fifo_reserved;
-	/** Request value */
-	int32_t val;
+    ADJ_SETTLE, // 按UP重新测量mosfet关断稳定时间
 };
 
 enum draw_mode{
@@ -53,21 +50,35 @@ struct app {
     struct controller *tip_ctrl;
     enum pid_adj p_adj;
     struct port0_data_t *pd_data;
-    uint32_t last_time; //记录最后刷新时间  
-                         
-    //刷新队列，如果发生事件会发送刷新，保证及时响应按键之类
-	struct k_fifo req_fifo;
-	struct req_value req;
+    enum draw_mode redraw; // 下次刷新是否需要清屏
+    // 服务执行器中的界面刷新和ina226读取，发生事件时马上刷新，保证及时响应按键之类
+    struct service_job draw_job;
+    struct service_job ina_job;
+    struct service_job fault_job; // 控制环路检测到故障变化时触发，转换成EVT_FAULT
+    struct i2c_bus_req ina_req; // ina_job只提交读取，在i2c总线线程中完成
+    atomic_t setpoint_input; // 主界面时为1，按键直接调整设定温度
 	struct k_mutex mutex;
+    // 主界面趋势图已画到的点和当前纵向范围上限（℃）
+    uint32_t trend_drawn;
+    int16_t trend_top_c;
 
     int32_t test;
 
 };
 
+// 只初始化界面状态，不访问屏幕
 void app_init(struct app *app);
 
+// 初始化屏幕并清屏，耗时较长，在控制环路启动后执行，然后开始周期刷新
+void app_display_init(struct app *app);
+
 void app_event_handler(struct app *app, enum event evt);
 
+// 深度睡眠时关闭背光、挂起屏幕和ina226，停止刷新
+void app_display_suspend(struct app *app);
+
+void app_display_resume(struct app *app);
+
 void app_draw(struct app *app);
 
 #endif // __APP_UI_H_
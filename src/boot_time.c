@@ -0,0 +1,88 @@
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <stdio.h>
+
+#include "boot_time.h"
+#include "heater_controller.h"
+#include "service.h"
+
+LOG_MODULE_REGISTER(boot_time, LOG_LEVEL_INF);
+
+// 等待第一次加热的检查间隔
+#define BOOT_REPORT_POLL_MS   100
+// 统计信息输出周期
+#define BOOT_STATS_PERIOD_MS  (60 * 1000)
+
+static uint32_t stage_us[BOOT_STAGE_COUNT];
+
+static const char *const stage_names[BOOT_STAGE_COUNT] = {
+	[BOOT_STAGE_MAIN] = "main",
+	[BOOT_STAGE_PD] = "pd",
+	[BOOT_STAGE_ADC] = "adc",
+	[BOOT_STAGE_CONTROL] = "control",
+	[BOOT_STAGE_ACCEL] = "accel",
+	[BOOT_STAGE_DISPLAY] = "display",
+	[BOOT_STAGE_FIRST_HEAT] = "first_heat",
+};
+
+void boot_mark(enum boot_stage stage)
+{
+	if (stage_us[stage] == 0) {
+		// 从上电开始计时，0表示未完成，至少记为1us
+		stage_us[stage] = MAX(k_ticks_to_us_floor32(k_uptime_ticks()), 1);
+	}
+}
+
+uint32_t boot_stage_us(enum boot_stage stage)
+{
+	return stage_us[stage];
+}
+
+void boot_log_report(void)
+{
+	char buf[160];
+	int len = 0;
+
+	// 一行输出，和其他周期统计一样便于从日志中提取
+	for (int i = 0; i < BOOT_STAGE_COUNT && len < sizeof(buf); i++) {
+		if (stage_us[i] == 0) {
+			len += snprintf(buf + len, sizeof(buf) - len, " %s -", stage_names[i]);
+		} else {
+			len += snprintf(buf + len, sizeof(buf) - len, " %s %u", stage_names[i],
+					stage_us[i]);
+		}
+	}
+	LOG_INF("boot us:%s", buf);
+}
+
+#if defined(CONFIG_TIP_LOAD_BOOST)
+// 负载事件统计，用于调整负载检测阈值和前馈时间
+static void load_log_report(void)
+{
+	const struct load_detector *ld = tip_load_stats();
+	uint32_t avg_ms = ld->events > 0 ? ld->total_recovery_ms / ld->events : 0;
+
+	LOG_INF("load: events %u recovery ms last %u max %u avg %u, last sag %d C", ld->events,
+		ld->last_recovery_ms, ld->max_recovery_ms, avg_ms, (int)ld->max_sag_c);
+}
+#endif
+
+static void report_handler(struct service_job *job)
+{
+	if (boot_stage_us(BOOT_STAGE_FIRST_HEAT) == 0) {
+		return;
+	}
+	boot_log_report();
+#if defined(CONFIG_TIP_LOAD_BOOST)
+	load_log_report();
+#endif
+	service_set_period(job, BOOT_STATS_PERIOD_MS);
+}
+
+static struct service_job report_job = SERVICE_JOB_INITIALIZER("boot", report_handler);
+
+void boot_report_init(void)
+{
+	service_add(&report_job, 0, BOOT_REPORT_POLL_MS);
+}
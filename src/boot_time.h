@@ -0,0 +1,30 @@
+#ifndef __BOOT_TIME_H
+#define __BOOT_TIME_H
+
+#include <stdint.h>
+
+// 启动各阶段完成的时间点
+enum boot_stage {
+  BOOT_STAGE_MAIN,       // 进入main，内核和驱动初始化完成
+  BOOT_STAGE_PD,         // usb-c协议栈启动
+  BOOT_STAGE_ADC,        // 热电偶adc和冷端温度
+  BOOT_STAGE_CONTROL,    // 控制环路启动（含电阻测量）
+  BOOT_STAGE_ACCEL,      // 加速度计休眠检测
+  BOOT_STAGE_DISPLAY,    // 屏幕初始化和清屏
+  BOOT_STAGE_FIRST_HEAT, // 第一次输出加热
+  BOOT_STAGE_COUNT,
+};
+
+// 记录阶段完成时间，只记录第一次
+void boot_mark(enum boot_stage stage);
+
+// 上电到该阶段完成的时间（us），未完成返回0
+uint32_t boot_stage_us(enum boot_stage stage);
+
+// 输出启动时间分布
+void boot_log_report(void);
+
+// 开始加热后输出一次启动时间分布，之后和其他统计信息一起周期输出
+void boot_report_init(void);
+
+#endif // __BOOT_TIME_H
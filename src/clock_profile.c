@@ -0,0 +1,158 @@
+
+#include <zephyr/kernel.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/logging/log.h>
+#include <stm32_ll_rcc.h>
+#include <stm32_ll_system.h>
+#include <stm32_ll_tim.h>
+#include <stm32_ll_spi.h>
+
+#include "app_ui.h"
+#include "clock_profile.h"
+#include "heater_controller.h"
+#include "service.h"
+
+LOG_MODULE_REGISTER(clock_profile, LOG_LEVEL_INF);
+
+/*
+ * zephyr的rcc配置在编译时固定，这里直接改寄存器：
+ * - ahb分频切换hclk，apb1/apb2分频为1，跟随hclk
+ * - 采样定时器tim3按比例减小分频，counter驱动缓存的1MHz计数频率保持不变
+ * - 加热pwm（tim2）分频为0，改为重新计算周期数
+ * - spi1在两次传输之间调整波特率分频
+ * - i2c2内核时钟在设备树中改为hsi16，不受hclk影响
+ * - adc使用hclk/4同步时钟，低速时采样时间变长，不影响结果
+ * - 系统节拍由lptim1提供，不受影响
+ */
+#define LOW_POWER_DIV CONFIG_CLOCK_LOW_POWER_AHB_DIV
+#define LOW_POWER_SHIFT LOG2(LOW_POWER_DIV)
+
+#define TIM3_NODE DT_PARENT(DT_NODELABEL(tip_adc_counter))
+#define TIM3_PRESCALER DT_PROP(TIM3_NODE, st_prescaler)
+#define SPI_NODE DT_PHANDLE(DT_PARENT(DT_CHOSEN(zephyr_display)), spi_dev)
+
+BUILD_ASSERT(IS_POWER_OF_TWO(LOW_POWER_DIV), "AHB divider must be a power of two");
+BUILD_ASSERT((TIM3_PRESCALER + 1) % LOW_POWER_DIV == 0,
+	     "tim3 prescaler can not keep the counter frequency");
+
+#if LOW_POWER_DIV == 2
+#define LOW_POWER_AHB_PRESCALER LL_RCC_SYSCLK_DIV_2
+#elif LOW_POWER_DIV == 4
+#define LOW_POWER_AHB_PRESCALER LL_RCC_SYSCLK_DIV_4
+#elif LOW_POWER_DIV == 8
+#define LOW_POWER_AHB_PRESCALER LL_RCC_SYSCLK_DIV_8
+#else
+#define LOW_POWER_AHB_PRESCALER LL_RCC_SYSCLK_DIV_16
+#endif
+
+// 切换时钟检查间隔（ms）
+#define CLOCK_POLL_MS 100
+
+// flash等待周期，range1 boost模式每个等待周期34MHz
+#define FLASH_WS_HZ 34000000U
+
+static TIM_TypeDef *const tim3 = (TIM_TypeDef *)DT_REG_ADDR(TIM3_NODE);
+static SPI_TypeDef *const spi = (SPI_TypeDef *)DT_REG_ADDR(SPI_NODE);
+
+static enum clock_profile current = CLOCK_PROFILE_PERFORMANCE;
+static uint32_t perf_latency;
+static uint32_t low_power_latency;
+static uint32_t perf_spi_br; // 全速时spi1的波特率分频
+
+static struct app *clock_app;
+
+// 不复位计数值，避免正在等待的采样和延时闹钟提前或推迟
+static void tim3_set_prescaler(uint32_t psc)
+{
+	uint32_t cnt = LL_TIM_GetCounter(tim3);
+
+	LL_TIM_SetPrescaler(tim3, psc);
+	LL_TIM_GenerateEvent_UPDATE(tim3);
+	LL_TIM_SetCounter(tim3, cnt);
+	LL_TIM_ClearFlag_UPDATE(tim3);
+}
+
+// 保持spi时钟不变，低速时分频已经最小则降低spi时钟；
+// 限幅后切回全速不能再按移位计算，恢复切换前保存的分频
+static void spi_low_power_baudrate(void)
+{
+	int br;
+
+	perf_spi_br = LL_SPI_GetBaudRatePrescaler(spi);
+	br = (int)(perf_spi_br >> SPI_CR1_BR_Pos) - LOW_POWER_SHIFT;
+	br = MAX(br, 0);
+	LL_SPI_SetBaudRatePrescaler(spi, (uint32_t)br << SPI_CR1_BR_Pos);
+}
+
+void clock_profile_set(enum clock_profile profile)
+{
+	unsigned int key;
+
+	if (profile == current) {
+		return;
+	}
+
+	key = irq_lock();
+	if (profile == CLOCK_PROFILE_LOW_POWER) {
+		// 降频后再减少等待周期
+		LL_RCC_SetAHBPrescaler(LOW_POWER_AHB_PRESCALER);
+		while (LL_RCC_GetAHBPrescaler() != LOW_POWER_AHB_PRESCALER) {
+		}
+		LL_FLASH_SetLatency(low_power_latency);
+		tim3_set_prescaler((TIM3_PRESCALER + 1) / LOW_POWER_DIV - 1);
+		spi_low_power_baudrate();
+	} else {
+		// 先增加等待周期再升频
+		LL_FLASH_SetLatency(perf_latency);
+		while (LL_FLASH_GetLatency() != perf_latency) {
+		}
+		LL_RCC_SetAHBPrescaler(LL_RCC_SYSCLK_DIV_1);
+		while (LL_RCC_GetAHBPrescaler() != LL_RCC_SYSCLK_DIV_1) {
+		}
+		tim3_set_prescaler(TIM3_PRESCALER);
+		LL_SPI_SetBaudRatePrescaler(spi, perf_spi_br);
+	}
+	// clock_control_get_rate按SystemCoreClock计算各总线频率
+	SystemCoreClockUpdate();
+	// pwm周期数在下次设置占空比时写入tim2
+	soldering_tip_pwm_set_clock_div(profile == CLOCK_PROFILE_LOW_POWER ? LOW_POWER_DIV : 1);
+	current = profile;
+	irq_unlock(key);
+
+	LOG_DBG("hclk %u Hz", SystemCoreClock);
+}
+
+enum clock_profile clock_profile_get(void)
+{
+	return current;
+}
+
+// 加热时（包括预热和休眠温度保温）全速运行，保证adc时钟和采样窗口不变；
+// 只在预览和烙铁头挂起等不加热时降频
+static void clock_policy_handler(struct service_job *job)
+{
+	struct controller *tip_ctrl = clock_app->tip_ctrl;
+
+	clock_profile_set(tip_ctrl->heater_on ? CLOCK_PROFILE_PERFORMANCE
+					      : CLOCK_PROFILE_LOW_POWER);
+}
+
+static struct service_job clock_job = SERVICE_JOB_INITIALIZER("clock", clock_policy_handler);
+
+void clock_profile_kick(void)
+{
+	service_kick(&clock_job);
+}
+
+int clock_profile_init(struct app *app)
+{
+	uint32_t perf_hclk = SystemCoreClock;
+
+	clock_app = app;
+	perf_latency = LL_FLASH_GetLatency();
+	low_power_latency = (perf_hclk / LOW_POWER_DIV - 1) / FLASH_WS_HZ;
+	service_add(&clock_job, CLOCK_POLL_MS, CLOCK_POLL_MS);
+
+	LOG_INF("Clock scaling %u/%u Hz", perf_hclk, perf_hclk / LOW_POWER_DIV);
+	return 0;
+}
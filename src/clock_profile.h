@@ -0,0 +1,33 @@
+#ifndef __CLOCK_PROFILE_H
+#define __CLOCK_PROFILE_H
+
+#include <stdint.h>
+
+// 运行时钟配置，pll固定144MHz，只切换ahb分频
+enum clock_profile {
+  CLOCK_PROFILE_PERFORMANCE, // 加热和瞬态响应，hclk = sysclk
+  CLOCK_PROFILE_LOW_POWER,   // 预览和深度睡眠等不加热时，hclk = sysclk / CONFIG_CLOCK_LOW_POWER_AHB_DIV
+};
+
+struct app;
+
+/**
+ * @brief 根据加热状态周期切换时钟配置
+ */
+int clock_profile_init(struct app *app);
+
+/**
+ * @brief 切换时钟配置，同时换算tim3分频、加热pwm周期和spi1波特率分频
+ *
+ * 只能在服务执行器中调用，保证切换时没有spi传输
+ */
+void clock_profile_set(enum clock_profile profile);
+
+enum clock_profile clock_profile_get(void);
+
+/**
+ * @brief 马上按加热状态重新选择时钟配置，可以在其他线程里调用
+ */
+void clock_profile_kick(void);
+
+#endif // __CLOCK_PROFILE_H
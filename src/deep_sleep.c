@@ -0,0 +1,114 @@
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/pm/policy.h>
+
+#include "app_ui.h"
+#include "clock_profile.h"
+#include "deep_sleep.h"
+
+LOG_MODULE_REGISTER(deep_sleep, LOG_LEVEL_INF);
+
+#define BUTTONS_NODE DT_NODELABEL(buttons)
+
+static const struct device *lis2dw_dev = DEVICE_DT_GET(DT_NODELABEL(lis2dw));
+
+// 按键是轮询模式，睡眠时另外打开按键的外部中断用于唤醒
+#define BUTTON_SPEC(node_id) GPIO_DT_SPEC_GET(node_id, gpios),
+static const struct gpio_dt_spec buttons[] = {DT_FOREACH_CHILD(BUTTONS_NODE, BUTTON_SPEC)};
+static struct gpio_callback button_cb[ARRAY_SIZE(buttons)];
+
+static struct app *sleep_app;
+static bool motion_wake_ready; // 加速度计唤醒阈值已设置
+static K_SEM_DEFINE(wake_sem, 0, 1);
+
+static void button_wake(const struct device *port, struct gpio_callback *cb, uint32_t pins)
+{
+	k_sem_give(&wake_sem);
+}
+
+static void motion_wake(const struct device *dev, const struct sensor_trigger *trig)
+{
+	k_sem_give(&wake_sem);
+}
+
+static int wake_sources_enable(bool enable)
+{
+	// prj.conf打开了CONFIG_LIS2DW12_THRESHOLD，驱动只接受阈值触发
+	struct sensor_trigger trig = {
+		.type = SENSOR_TRIG_THRESHOLD,
+		.chan = SENSOR_CHAN_ACCEL_XYZ,
+	};
+	int ret;
+
+	for (int i = 0; i < ARRAY_SIZE(buttons); i++) {
+		gpio_pin_interrupt_configure_dt(&buttons[i],
+						enable ? GPIO_INT_EDGE_TO_ACTIVE : GPIO_INT_DISABLE);
+	}
+	ret = sensor_trigger_set(lis2dw_dev, &trig, enable ? motion_wake : NULL);
+	if (ret < 0 && enable) {
+		LOG_ERR("Accelerometer wake-up trigger failed: %d", ret);
+		return ret;
+	}
+	return 0;
+}
+
+int deep_sleep_init(struct app *app)
+{
+	struct sensor_value thresh;
+
+	sleep_app = app;
+	// stop模式会停掉加热pwm和采样定时器，只允许在深度睡眠时进入
+	pm_policy_state_lock_get(PM_STATE_SUSPEND_TO_IDLE, PM_ALL_SUBSTATES);
+	for (int i = 0; i < ARRAY_SIZE(buttons); i++) {
+		gpio_init_callback(&button_cb[i], button_wake, BIT(buttons[i].pin));
+		gpio_add_callback_dt(&buttons[i], &button_cb[i]);
+	}
+	sensor_ug_to_ms2(CONFIG_DEEP_SLEEP_WAKE_THRESHOLD_MG * 1000, &thresh);
+	int ret = sensor_attr_set(lis2dw_dev, SENSOR_CHAN_ACCEL_XYZ, SENSOR_ATTR_UPPER_THRESH,
+				  &thresh);
+	if (ret < 0) {
+		// 拿起烙铁无法唤醒，不进入深度睡眠
+		LOG_ERR("Accelerometer wake-up threshold failed: %d", ret);
+		return ret;
+	}
+	motion_wake_ready = true;
+	return 0;
+}
+
+int deep_sleep_enter(void)
+{
+	if (!motion_wake_ready) {
+		return -ENOTSUP;
+	}
+	// 先打开唤醒源，失败时保持当前状态，不进入stop模式
+	k_sem_reset(&wake_sem);
+	if (wake_sources_enable(true) < 0) {
+		wake_sources_enable(false);
+		return -EIO;
+	}
+	LOG_INF("Enter deep sleep");
+
+	tip_suspend();
+	app_display_suspend(sleep_app);
+#if defined(CONFIG_CLOCK_SCALING)
+	// 退出stop模式时按设备树重新配置rcc，先回到全速保持一致
+	clock_profile_set(CLOCK_PROFILE_PERFORMANCE);
+#endif
+
+	// 没有其他任务，空闲线程由电源管理进入stop模式
+	pm_policy_state_lock_put(PM_STATE_SUSPEND_TO_IDLE, PM_ALL_SUBSTATES);
+	k_sem_take(&wake_sem, K_FOREVER);
+	pm_policy_state_lock_get(PM_STATE_SUSPEND_TO_IDLE, PM_ALL_SUBSTATES);
+	wake_sources_enable(false);
+
+	app_display_resume(sleep_app);
+	tip_resume();
+
+	LOG_INF("Wake from deep sleep");
+	return 0;
+}
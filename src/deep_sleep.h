@@ -0,0 +1,17 @@
+#ifndef __DEEP_SLEEP_H
+#define __DEEP_SLEEP_H
+
+struct app;
+
+int deep_sleep_init(struct app *app);
+
+/**
+ * @brief 关闭加热、屏幕和ina226后等待加速度计或按键唤醒，唤醒后恢复才返回
+ *
+ * 调用期间cpu没有任务，由电源管理进入stop模式，系统节拍由lptim1提供
+ * @retval 0 已经睡眠并唤醒
+ * @retval 负数 加速度计唤醒不可用，没有进入睡眠
+ */
+int deep_sleep_enter(void);
+
+#endif // __DEEP_SLEEP_H
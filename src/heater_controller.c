@@ -1,13 +1,25 @@
 
 
+#include <math.h>
+#include <stdlib.h>
 #include <zephyr/device.h>
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/pwm.h>
+#include <zephyr/drivers/adc.h>
+#include <zephyr/drivers/sensor.h>
 #include <zephyr/logging/log.h>
+#include <stm32_ll_tim.h>
 
 #include "app_ui.h"
 #include "heater_controller.h"
 #include "temperature_adc.h"
+#include "tip_settings.h"
+#include "boot_time.h"
+#include "service.h"
+#include "trend.h"
+#include "adc_quiet.h"
+#include "vbus_monitor.h"
+#include "clock_profile.h"
 
 LOG_MODULE_REGISTER(soldering_tip_controller);
 
@@ -17,6 +29,43 @@ LOG_MODULE_REGISTER(soldering_tip_controller);
 
 #define PID_MAX_OUTPUT 450
 
+#if defined(CONFIG_PID_GAIN_SCHEDULING)
+// 默认增益表：温度越高散热越大，需要更大的增益；
+// 升温时不积分，加大比例和微分，靠近设定温度后平滑切回保温增益
+static const pid_gain_point default_hold_gains[] = {
+	{200, PID_KP * 0.8f, PID_KI * 0.8f, PID_KD * 0.8f},
+	{300, PID_KP, PID_KI, PID_KD},
+	{420, PID_KP * 1.3f, PID_KI * 1.3f, PID_KD * 1.3f},
+};
+static const pid_gain_point default_heat_gains[] = {
+	{200, PID_KP * 1.2f, 0, PID_KD * 1.5f},
+	{300, PID_KP * 1.5f, 0, PID_KD * 1.5f},
+	{420, PID_KP * 2.0f, 0, PID_KD * 1.5f},
+};
+#endif
+
+#define HEATER_R_OHM (CONFIG_TIP_HEATER_RESISTANCE_MOHM / 1000.0f)
+// 测量和在线修正共用的有效范围，超出认为测量无效
+#define HEATER_R_MIN_OHM (HEATER_R_OHM / 2)
+#define HEATER_R_MAX_OHM (HEATER_R_OHM * 2)
+
+#if defined(CONFIG_TIP_TEMP_KALMAN)
+#define TIP_KF_CFG(name) (CONFIG_TIP_KF_##name##_1000X / 1000.0f)
+#else
+#define TIP_KF_CFG(name) 0
+#endif
+
+#if defined(CONFIG_TIP_SMITH_PREDICTOR)
+// 历史记录按最短采样周期能覆盖的死区时间
+#if defined(CONFIG_TIP_ADAPTIVE_SAMPLING)
+#define SMITH_MAX_DEAD_MS (SMITH_MAX_HISTORY * CONFIG_TIP_SAMPLING_FAST_PERIOD_MS)
+#else
+#define SMITH_MAX_DEAD_MS (SMITH_MAX_HISTORY * CONFIG_TIP_SAMPLING_PERIOD_MS)
+#endif
+// 温升小于该值认为是冷态加热，可以辨识死区时间
+#define SMITH_IDENT_MAX_RISE_C 30.0f
+#endif
+
 // 定时采样通道
 #define TIP_ADC_COUNTER_CHAN 0
 /* 用于延时的timers通道 */
@@ -30,72 +79,974 @@ static struct controller tip_ctrl;
 // 从设备树获得pwm周期
 #define PWM_PERIOD_NS DT_PWMS_PERIOD_BY_IDX(PWM_DEVICE, 0)
 
+#define PWM_TIMER_NODE DT_PARENT(DT_PWMS_CTLR(PWM_DEVICE))
+
 static const struct pwm_dt_spec pwm_dev = PWM_DT_SPEC_GET(PWM_DEVICE);
 
-int soldering_tip_pwm_set_duty_cycle(uint8_t percent)
+// pwm周期和最小脉宽对应的定时器周期数
+static uint32_t pwm_period_cycles;
+static uint32_t pwm_min_pulse_cycles;
+// sigma-delta累积误差（周期数，Q16）
+static int64_t pwm_sd_error;
+// 全速时钟下的定时器频率，驱动初始化时缓存，降频后不会更新
+static uint64_t pwm_cycles_per_sec;
+
+static void soldering_tip_pwm_calc_cycles(uint64_t cycles_per_sec)
 {
-	if (percent > CONFIG_MAX_DUTY_CYCLE) {
-		percent = CONFIG_MAX_DUTY_CYCLE;
-	}
+	pwm_period_cycles = (uint32_t)(cycles_per_sec * PWM_PERIOD_NS / NSEC_PER_SEC);
+	// 脉冲时间太小容易震荡
+	pwm_min_pulse_cycles = (uint32_t)DIV_ROUND_UP(cycles_per_sec * 1000, NSEC_PER_SEC);
+	pwm_sd_error = 0;
+}
+
+static int soldering_tip_pwm_init(void)
+{
+	int ret;
 
-	/* 将百分比转换为纳秒 */
-	uint32_t pulse_ns = percent * (PWM_PERIOD_NS / 100);
-	if (pulse_ns < 1000) { // 脉冲时间太小容易震荡
-		pulse_ns = 0;
+	ret = pwm_get_cycles_per_sec(pwm_dev.dev, pwm_dev.channel, &pwm_cycles_per_sec);
+	if (ret != 0) {
+		return ret;
 	}
+	soldering_tip_pwm_calc_cycles(pwm_cycles_per_sec);
+	return 0;
+}
 
-	/* 设置 PWM 周期和脉宽 */
-	return pwm_set_dt(&pwm_dev, PWM_PERIOD_NS, pulse_ns);
+void soldering_tip_pwm_set_clock_div(uint32_t div)
+{
+	soldering_tip_pwm_calc_cycles(pwm_cycles_per_sec / div);
 }
 
-static void heater_update(const struct controller *tip_ctrl)
+void soldering_tip_pwm_force_off(bool force)
 {
-	// 测试
-	uint8_t duty;
-	if (tip_ctrl->heater_on) {
-		float pid_out = pid_get_output(&tip_ctrl->pid);
-		duty = (uint8_t)(((pid_out / PID_MAX_OUTPUT)) * CONFIG_MAX_DUTY_CYCLE);
+	static TIM_TypeDef *const tim = (TIM_TypeDef *)DT_REG_ADDR(PWM_TIMER_NODE);
+	static const uint32_t ll_channels[] = {LL_TIM_CHANNEL_CH1, LL_TIM_CHANNEL_CH2,
+					       LL_TIM_CHANNEL_CH3, LL_TIM_CHANNEL_CH4};
+
+	// 强制模式马上生效，pwm驱动修改占空比时只写比较值，不会改回pwm模式
+	LL_TIM_OC_SetMode(tim, ll_channels[pwm_dev.channel - 1],
+			  force ? LL_TIM_OCMODE_FORCED_INACTIVE : LL_TIM_OCMODE_PWM1);
+}
+
+int soldering_tip_pwm_set_duty_cycle(uint32_t duty_q16)
+{
+	if (duty_q16 > MAX_DUTY_Q16) {
+		duty_q16 = MAX_DUTY_Q16;
+	}
+	if (duty_q16 == 0) {
+		pwm_sd_error = 0;
+		return soldering_tip_pwm_off();
+	}
+
+	/*
+	 * 一阶sigma-delta：目标脉宽加上之前的量化误差，再量化到定时器周期，
+	 * 小于最小脉宽时在0和最小脉宽之间抖动，平均功率仍然准确
+	 */
+	int64_t want = (int64_t)duty_q16 * pwm_period_cycles + pwm_sd_error;
+	int64_t min_pulse = (int64_t)pwm_min_pulse_cycles << 16;
+	uint32_t pulse;
+
+	if (want <= 0) {
+		pulse = 0;
+	} else if (want < min_pulse) {
+		pulse = want >= min_pulse / 2 ? pwm_min_pulse_cycles : 0;
 	} else {
+		pulse = (uint32_t)(want >> 16);
+	}
+	pwm_sd_error = CLAMP(want - ((int64_t)pulse << 16), -min_pulse, min_pulse);
+
+	return pwm_set_cycles(pwm_dev.dev, pwm_dev.channel, pwm_period_cycles, pulse,
+			      pwm_dev.flags);
+}
+
+int soldering_tip_pwm_off(void)
+{
+	return pwm_set_cycles(pwm_dev.dev, pwm_dev.channel, pwm_period_cycles, 0, pwm_dev.flags);
+}
+
+#if defined(CONFIG_TIP_CASCADE_POWER_LOOP)
+// 功率内环：用adc1测得的vbus电压和发热芯电阻把目标功率换算成占空比，
+// 电源电压变化在同一个采样周期内就被补偿，不需要等温度环响应
+// 电阻修正的滤波系数
+#define HEATER_R_ALPHA 0.05f
+
+// 用ina226的平均功率慢速修正等效电阻
+static void power_loop_adapt(struct controller *tip_ctrl)
+{
+	if (!tip_ctrl->ina_fresh) {
+		return;
+	}
+	tip_ctrl->ina_fresh = false;
+
+	float duty = (float)tip_ctrl->duty_q16 / DUTY_Q16_ONE;
+	float v = tip_ctrl->ina_vbus_mv / 1000.0f;
+	float p = tip_ctrl->ina_power_mw / 1000.0f;
+	if (duty < 0.1f || p < 1.0f) {
+		return;
+	}
+	float r = duty * v * v / p;
+	r = CLAMP(r, HEATER_R_MIN_OHM, HEATER_R_MAX_OHM);
+	tip_ctrl->heater_r_ohm += HEATER_R_ALPHA * (r - tip_ctrl->heater_r_ohm);
+}
+
+static uint32_t power_to_duty(struct controller *tip_ctrl, float power_w)
+{
+	if (vbus_monitor_read_mv(&tip_ctrl->vbus_mv) != 0) {
+		tip_ctrl->vbus_mv = tip_ctrl->ina_vbus_mv;
+	}
+	float v = tip_ctrl->vbus_mv / 1000.0f;
+	if (v < 1.0f) {
+		return 0;
+	}
+	float full_power = v * v / tip_ctrl->heater_r_ohm;
+	float duty = power_w / full_power;
+	return (uint32_t)(MIN(duty, 1.0f) * DUTY_Q16_ONE);
+}
+#endif
+
+static void heater_apply(struct controller *tip_ctrl, uint32_t duty)
+{
+	// 限制在电源档位允许的电流内
+	duty = MIN(duty, tip_ctrl->duty_limit_q16);
+	if (tip_ctrl->sampling_stopped) {
 		duty = 0;
 	}
+#if defined(CONFIG_VBUS_BROWNOUT_GUARD)
+	// 掉电中断可能在计算过程中关断加热，检查和设置pwm之间不能被打断
+	unsigned int key = irq_lock();
+
+	duty = vbus_monitor_limit_duty(duty, tip_ctrl->adc_cfg.elapsed_period_ms);
+	soldering_tip_pwm_set_duty_cycle(duty);
+	irq_unlock(key);
+#else
 	soldering_tip_pwm_set_duty_cycle(duty);
+#endif
+	tip_ctrl->duty_q16 = duty;
+	if (duty > 0) {
+		boot_mark(BOOT_STAGE_FIRST_HEAT);
+	}
 }
 
+static void heater_update(struct controller *tip_ctrl)
+{
+	uint32_t duty;
+	if (tip_ctrl->heater_on) {
+		float pid_out = tip_ctrl->boost_active ? tip_ctrl->boost_output
+						       : pid_get_output(&tip_ctrl->pid);
+#if defined(CONFIG_TIP_CASCADE_POWER_LOOP)
+		// 温度外环输出目标功率
+		tip_ctrl->power_cmd_w = pid_out / PID_MAX_OUTPUT * CONFIG_TIP_MAX_POWER_W;
+		power_loop_adapt(tip_ctrl);
+		duty = power_to_duty(tip_ctrl, tip_ctrl->power_cmd_w);
+#else
+		duty = (uint32_t)((pid_out / PID_MAX_OUTPUT) * MAX_DUTY_Q16);
+#endif
+		// 反算抗饱和：把最大占空比等后级限幅换算回pid输出
+		uint32_t applied = MIN(duty, tip_ctrl->duty_limit_q16);
+		if (duty > 0 && !tip_ctrl->boost_active) {
+			pid_track(&tip_ctrl->pid, pid_out * ((float)applied / duty));
+		}
+	} else {
+		tip_ctrl->power_cmd_w = 0;
+		duty = 0;
+	}
+	heater_apply(tip_ctrl, duty);
+}
 
 //
 
 static const struct device *tip_adc_counter_dev = DEVICE_DT_GET(DT_NODELABEL(tip_adc_counter));
 
+// tim3是16位计数器，1MHz计数时一次定时最长65535us，超过时counter驱动拒绝设置
+#define SAMPLING_COUNTER_MAX_US 65535
+BUILD_ASSERT(CONFIG_TIP_SAMPLING_PERIOD_MS * 1000 <= SAMPLING_COUNTER_MAX_US,
+	     "sampling period does not fit the 16-bit counter");
+#if defined(CONFIG_TIP_ADAPTIVE_SAMPLING)
+BUILD_ASSERT(CONFIG_TIP_SAMPLING_FAST_PERIOD_MS * 1000 <= SAMPLING_COUNTER_MAX_US,
+	     "fast sampling period does not fit the 16-bit counter");
+BUILD_ASSERT(CONFIG_TIP_SAMPLING_SLOW_PERIOD_MS * 1000 <= SAMPLING_COUNTER_MAX_US,
+	     "slow sampling period does not fit the 16-bit counter");
+#endif
+
+// 采样定时器设置失败后不会再有采样，闭环、故障检测都停止，只能关断加热
+static void sampling_stop(struct controller *tip_ctrl, int ret)
+{
+	tip_ctrl->sampling_stopped = true;
+	heater_off();
+	tip_ctrl->duty_q16 = 0;
+	LOG_ERR("Sampling alarm failed: %d, heater off", ret);
+}
+
+// 关断到采样的延时范围，测量结果和保存的值都限制在这个范围内
+#define SETTLE_MIN_US    100
+#define SETTLE_MAX_US    5000
+
+#if defined(CONFIG_TIP_SETTLE_CALIBRATION)
+// 测量mosfet关断后热电偶放大器输出的衰减曲线
+#define SETTLE_PULSE_MS  5   // 测量前加热脉冲时间
+#define SETTLE_RUNS      4   // 测量次数，取最大值
+#define SETTLE_SAMPLES   128 // 每次测量最多的采样点数
+#define SETTLE_FINAL_CNT 8   // 用最后几个点的平均值作为稳定值
+// 采样点太少时分辨不出衰减曲线
+#define SETTLE_MIN_SAMPLES (SETTLE_FINAL_CNT * 4)
+#define SETTLE_CONV_RUNS 4   // 测量adc转换时间的次数，取最大值
+// 采样窗口取默认延时的两倍
+#define SETTLE_WINDOW_US MIN(CONFIG_MOSFET_OFF_DELAY_US * 2, SETTLE_MAX_US)
+
+static uint16_t settle_raw[SETTLE_SAMPLES];
+static uint16_t settle_ts[SETTLE_SAMPLES];
+
+static uint32_t counter_elapsed_us(uint32_t start)
+{
+	uint32_t now;
+
+	counter_get_value(tip_adc_counter_dev, &now);
+	// 计数器是16位的，需要处理回绕
+	uint32_t ticks = (now - start) & counter_get_top_value(tip_adc_counter_dev);
+	return (uint32_t)counter_ticks_to_us(tip_adc_counter_dev, ticks);
+}
+
+// 一次adc转换加读取的时间，包括过采样，决定采样点的最小间隔
+static int settle_conv_us(void)
+{
+	uint32_t start;
+	uint32_t raw;
+	uint32_t max_us = 0;
+
+	for (int i = 0; i < SETTLE_CONV_RUNS; i++) {
+		counter_get_value(tip_adc_counter_dev, &start);
+		if (temp_read_adc_raw(&raw) != 0) {
+			return -EIO;
+		}
+		max_us = MAX(max_us, counter_elapsed_us(start));
+	}
+	return max_us;
+}
+
+// 返回关断后到信号稳定所需的时间(us)，失败返回负数
+static int settle_measure_once(struct controller *tip_ctrl, uint32_t slot_us, int samples)
+{
+	uint32_t start;
+	uint32_t raw;
+	uint32_t sum = 0;
+
+	// 经过电源档位和vbus跌落的限制
+	heater_apply(tip_ctrl, MAX_DUTY_Q16);
+	k_msleep(SETTLE_PULSE_MS);
+
+	heater_off();
+	counter_get_value(tip_adc_counter_dev, &start);
+
+	for (int i = 0; i < samples; i++) {
+		uint32_t t_us;
+		do {
+			t_us = counter_elapsed_us(start);
+		} while (t_us < i * slot_us);
+
+		if (temp_read_adc_raw(&raw) != 0) {
+			return -EIO;
+		}
+		settle_raw[i] = raw;
+		settle_ts[i] = t_us;
+	}
+
+	for (int i = samples - SETTLE_FINAL_CNT; i < samples; i++) {
+		sum += settle_raw[i];
+	}
+	int32_t final = sum / SETTLE_FINAL_CNT;
+
+	// 从后往前找最后一个超出容差的点
+	for (int i = samples - 1; i >= 0; i--) {
+		if (abs((int32_t)settle_raw[i] - final) > CONFIG_TIP_SETTLE_TOLERANCE_RAW) {
+			if (i >= samples - SETTLE_FINAL_CNT) {
+				return -EAGAIN; // 窗口内没有稳定
+			}
+			return settle_ts[i + 1];
+		}
+	}
+	return settle_ts[0];
+}
+
+static void settle_calibrate(struct controller *tip_ctrl)
+{
+	int settle_us = 0;
+
+	// 测量期间停止定时采样
+	counter_cancel_channel_alarm(tip_adc_counter_dev, TIP_ADC_COUNTER_CHAN);
+
+	// 采样间隔不能小于一次转换的时间，窗口内能放下的点数不够时放弃测量
+	int conv_us = settle_conv_us();
+	uint32_t slot_us = MAX(SETTLE_WINDOW_US / SETTLE_SAMPLES, MAX(conv_us, 1));
+	int samples = MIN(SETTLE_WINDOW_US / slot_us, SETTLE_SAMPLES);
+
+	if (conv_us < 0) {
+		settle_us = conv_us;
+	} else if (samples < SETTLE_MIN_SAMPLES) {
+		LOG_WRN("ADC conversion %d us too slow for settle measurement", conv_us);
+		settle_us = -ERANGE;
+	}
+	for (int i = 0; i < SETTLE_RUNS && settle_us >= 0; i++) {
+		int ret = settle_measure_once(tip_ctrl, slot_us, samples);
+		if (ret < 0) {
+			LOG_WRN("Settle time measurement failed: %d", ret);
+			settle_us = ret;
+			break;
+		}
+		settle_us = MAX(settle_us, ret);
+	}
+	// 脉冲后duty_q16还是最大值，清零避免下一次采样按满功率估计
+	heater_apply(tip_ctrl, 0);
+
+	if (settle_us >= 0) {
+		settle_us = CLAMP(settle_us + CONFIG_TIP_SETTLE_MARGIN_US, SETTLE_MIN_US,
+				  SETTLE_MAX_US);
+		LOG_INF("Settle time %d us (%d samples every %u us)", settle_us, samples, slot_us);
+		tip_ctrl->settle_us = settle_us;
+		tip_ctrl->adc_cfg.delay_cfg.ticks =
+			counter_us_to_ticks(tip_adc_counter_dev, settle_us);
+		// 变化不大时不写flash
+		if (abs(settle_us - (int)tip_settings_get()->settle_us) > SETTLE_MIN_US / 4) {
+			tip_settings_save_settle_us(settle_us);
+		}
+	}
+	tip_ctrl->settle_pending = false;
+
+	int ret = counter_set_channel_alarm(tip_adc_counter_dev, TIP_ADC_COUNTER_CHAN,
+					    &tip_ctrl->adc_cfg.sampling_cfg);
+	if (ret != 0) {
+		sampling_stop(tip_ctrl, ret);
+	}
+}
+
+void tip_request_settle_calibration(void)
+{
+	tip_ctrl.settle_pending = true;
+}
+#else
+void tip_request_settle_calibration(void)
+{
+}
+#endif
+
+#if defined(CONFIG_PID_GAIN_SCHEDULING)
+// 停止调整一段时间后再保存，避免每次按键都写flash
+#define GAINS_SAVE_DELAY_MS 3000
+
+static void gains_save_handler(struct service_job *job)
+{
+	ARG_UNUSED(job);
+	tip_settings_save_gains(&tip_ctrl.gain_sched);
+}
+
+static struct service_job gains_save_job =
+	SERVICE_JOB_INITIALIZER("gains save", gains_save_handler);
+#endif
+
+void tip_get_hold_gains(float *kp, float *ki, float *kd)
+{
+#if defined(CONFIG_PID_GAIN_SCHEDULING)
+	// 显示表中的值，pid当前的增益是插值和升温混合后的结果
+	const pid_gain_schedule *sched = &tip_ctrl.gain_sched;
+	const pid_gain_point *pt = &sched->hold[pid_schedule_nearest(sched, tip_ctrl.setpoint)];
+
+	*kp = pt->kp;
+	*ki = pt->ki;
+	*kd = pt->kd;
+#else
+	*kp = pid_get_kp(&tip_ctrl.pid);
+	*ki = pid_get_ki(&tip_ctrl.pid);
+	*kd = pid_get_kd(&tip_ctrl.pid);
+#endif
+}
+
+void tip_set_hold_gains(float kp, float ki, float kd)
+{
+	if (kp < 0 || ki < 0 || kd < 0) {
+		return;
+	}
+#if defined(CONFIG_PID_GAIN_SCHEDULING)
+	pid_gain_schedule *sched = &tip_ctrl.gain_sched;
+	uint8_t idx = pid_schedule_nearest(sched, tip_ctrl.setpoint);
+
+	// 控制环路下一次采样按新的表重新插值
+	sched->hold[idx].kp = kp;
+	sched->hold[idx].ki = ki;
+	sched->hold[idx].kd = kd;
+	// 每次调整都推迟保存
+	service_add(&gains_save_job, GAINS_SAVE_DELAY_MS, 0);
+#else
+	pid_set_tunings(&tip_ctrl.pid, kp, ki, kd);
+#endif
+}
+
+#if defined(CONFIG_TIP_WAKE_BOOST) || defined(CONFIG_TIP_LOAD_BOOST)
+#define TIP_BOOST 1
+// 按升温速率向前预测的采样次数，提前结束boost避免过冲
+#define BOOST_LEAD_SAMPLES 4
+// 保温输出估计的滤波系数
+#define HOLD_OUTPUT_ALPHA  0.02f
+// 误差在该范围内认为已达到目标温度
+#define HOLD_BAND_C        2.0f
+
+// 温度稳定时记录保温输出，目标温度改变时按温升比例换算
+static void hold_output_track(struct controller *tip_ctrl, float temp, float target)
+{
+	float ambient = get_cool_temp();
+
+	if (target != tip_ctrl->hold_target) {
+		if (tip_ctrl->hold_target > ambient + 1.0f && target > ambient) {
+			tip_ctrl->hold_output *=
+				(target - ambient) / (tip_ctrl->hold_target - ambient);
+			tip_ctrl->hold_output = MIN(tip_ctrl->hold_output, PID_MAX_OUTPUT);
+		} else {
+			tip_ctrl->hold_output = 0;
+		}
+		tip_ctrl->hold_target = target;
+	}
+	if (tip_ctrl->pid_active && !tip_ctrl->boost_active &&
+	    fabsf(target - temp) < HOLD_BAND_C) {
+		tip_ctrl->hold_output += HOLD_OUTPUT_ALPHA *
+					 (pid_get_output(&tip_ctrl->pid) - tip_ctrl->hold_output);
+	}
+}
+
+static void boost_start(struct controller *tip_ctrl, uint32_t duration_ms, float output)
+{
+	tip_ctrl->boost_end_ms = k_uptime_get_32() + duration_ms;
+	tip_ctrl->boost_output = output;
+	tip_ctrl->boost_active = true;
+}
+
+static void boost_update(struct controller *tip_ctrl, float temp, float target)
+{
+	if (!tip_ctrl->boost_active) {
+		return;
+	}
+	float lead_s = tip_ctrl->adc_cfg.elapsed_period_ms * BOOST_LEAD_SAMPLES / 1000.0f;
+	float predicted = temp + tip_ctrl->temp_rate * lead_s;
+
+	if (!tip_ctrl->heater_on || (int32_t)(k_uptime_get_32() - tip_ctrl->boost_end_ms) >= 0 ||
+	    predicted >= target) {
+		tip_ctrl->boost_active = false;
+		// 交还给pid，积分项预置为目标温度下的保温输出
+		pid_reset(&tip_ctrl->pid, temp, target, tip_ctrl->hold_output);
+		pid_set_integral(&tip_ctrl->pid, tip_ctrl->hold_output);
+	}
+}
+#endif
+
+#if defined(CONFIG_TIP_WAKE_BOOST)
+// 唤醒时温差小于该值不需要前馈
+#define WAKE_BOOST_MIN_DELTA_C 10.0f
+
+static void wake_boost_update(struct controller *tip_ctrl, float temp, float target)
+{
+	if (!tip_ctrl->wake_pending || tip_ctrl->is_sleeping) {
+		return;
+	}
+#if defined(CONFIG_CLOCK_SCALING)
+	// 等切换到全速后再开始前馈加热，降频时adc时钟和关断采样窗口都变长
+	if (tip_ctrl->heater_on && clock_profile_get() != CLOCK_PROFILE_PERFORMANCE) {
+		return;
+	}
+#endif
+	tip_ctrl->wake_pending = false;
+
+	float delta = target - temp;
+	if (!tip_ctrl->heater_on || delta < WAKE_BOOST_MIN_DELTA_C) {
+		return;
+	}
+	uint32_t ms = MIN((uint32_t)(delta * CONFIG_TIP_WAKE_BOOST_MS_PER_C),
+			  CONFIG_TIP_WAKE_BOOST_MAX_MS);
+	boost_start(tip_ctrl, ms, PID_MAX_OUTPUT);
+	LOG_DBG("Wake boost %u ms, preload %d", ms, (int)tip_ctrl->hold_output);
+}
+#endif
+
+#if defined(CONFIG_TIP_LOAD_BOOST)
+// ina226功率比稳定时的基线高出该比例认为负载增加
+#define LOAD_POWER_RISE_PERCENT 30
+#define LOAD_POWER_ALPHA        0.05f
+
+// 焊点接触检测：温度稳定后出现明显跌落，同时温度快速下降或功率上升
+static void load_boost_update(struct controller *tip_ctrl, float temp, float target)
+{
+	struct load_detector *ld = &tip_ctrl->load;
+	uint16_t elapsed = tip_ctrl->adc_cfg.elapsed_period_ms;
+	float slope = elapsed > 0 ? (temp - ld->last_temp) * 1000.0f / elapsed : 0;
+	float error = target - temp;
+	uint32_t now = k_uptime_get_32();
+
+	ld->last_temp = temp;
+	// ina_fresh由功率内环清除，这里按序号判断是否有新读数
+	bool ina_new = tip_ctrl->ina_seq != ld->ina_seq;
+	ld->ina_seq = tip_ctrl->ina_seq;
+
+	if (!tip_ctrl->heater_on || tip_ctrl->is_sleeping) {
+		ld->armed = false;
+		ld->in_event = false;
+		return;
+	}
+
+	if (ld->in_event) {
+		ld->max_sag_c = MAX(ld->max_sag_c, error);
+		if (error < HOLD_BAND_C) {
+			// 回到目标温度，统计恢复时间
+			uint32_t recovery = now - ld->start_ms;
+			ld->in_event = false;
+			ld->last_recovery_ms = recovery;
+			ld->max_recovery_ms = MAX(ld->max_recovery_ms, recovery);
+			ld->total_recovery_ms += recovery;
+			LOG_INF("Load event %u: sag %d C, recovered in %u ms", ld->events,
+				(int)ld->max_sag_c, recovery);
+		}
+		return;
+	}
+
+	if (fabsf(error) < HOLD_BAND_C) {
+		ld->armed = true;
+		if (ina_new) {
+			ld->power_baseline_mw +=
+				LOAD_POWER_ALPHA * (tip_ctrl->ina_power_mw - ld->power_baseline_mw);
+		}
+		return;
+	}
+	if (!ld->armed || tip_ctrl->boost_active || error < CONFIG_TIP_LOAD_DETECT_ERROR_C) {
+		return;
+	}
+
+	bool falling = slope < -CONFIG_TIP_LOAD_DETECT_RATE_C_S;
+	bool power_rise = ld->power_baseline_mw > 0 && ina_new &&
+			  tip_ctrl->ina_power_mw * 100 >
+				  ld->power_baseline_mw * (100 + LOAD_POWER_RISE_PERCENT);
+	if (!falling && !power_rise) {
+		return;
+	}
+
+	ld->armed = false;
+	ld->in_event = true;
+	ld->events++;
+	ld->start_ms = now;
+	ld->max_sag_c = error;
+
+	uint32_t ms = MIN((uint32_t)(error * CONFIG_TIP_LOAD_BOOST_MS_PER_C),
+			  CONFIG_TIP_LOAD_BOOST_MAX_MS);
+	boost_start(tip_ctrl, ms, PID_MAX_OUTPUT);
+}
+
+const struct load_detector *tip_load_stats(void)
+{
+	return &tip_ctrl.load;
+}
+#endif
+
+void tip_suspend(void)
+{
+	tip_ctrl.heater_on = false;
+	tip_ctrl.preheat = false;
+	// 停止采样定时器，深度睡眠时不再唤醒cpu
+	counter_stop(tip_adc_counter_dev);
+	heater_off();
+#if defined(CONFIG_DISPLAY_ADC_QUIET)
+	// 延时通道的中断不会再来，关闭可能已经打开的采样窗口，屏幕传输不再等待
+	adc_quiet_end();
+#endif
+}
+
+void tip_resume(void)
+{
+	// 睡眠期间温度变化很大，重新初始化温度估计
+	tip_ctrl.kf.inited = false;
+	tip_ctrl.pid_active = false;
+#if defined(CONFIG_TIP_FAULT_DETECTION)
+	// 睡眠前的采样已经过时，重新开始滤波和变化速率检查
+	tip_ctrl.fault.last_valid = false;
+#endif
+	counter_start(tip_adc_counter_dev);
+}
+
+// 冷端温度用mcu内部温度，加热时板子温度受烙铁影响，只在停止加热时刷新
+#define CJC_REFRESH_PERIOD_MS 5000
+
+static void cjc_refresh_handler(struct service_job *job)
+{
+	ARG_UNUSED(job);
+	if (!tip_ctrl.heater_on) {
+		update_cool_temp();
+	}
+}
+
+static struct service_job cjc_job = SERVICE_JOB_INITIALIZER("cjc", cjc_refresh_handler);
+
+void tip_set_supply_limit(uint16_t mv, uint16_t ma)
+{
+#if defined(CONFIG_VBUS_BROWNOUT_GUARD)
+	vbus_monitor_set_nominal(mv);
+#endif
+	if (mv == 0) {
+		tip_ctrl.duty_limit_q16 = MAX_DUTY_Q16;
+		return;
+	}
+	// 平均电流 = duty * V / R
+	float duty = (float)ma * tip_ctrl.heater_r_ohm / mv;
+	tip_ctrl.duty_limit_q16 = MIN((uint32_t)(duty * DUTY_Q16_ONE), MAX_DUTY_Q16);
+	LOG_INF("Supply %u mV %u mA, duty limit %u%%", mv, ma,
+		tip_ctrl.duty_limit_q16 * 100 / DUTY_Q16_ONE);
+}
+
+#if defined(CONFIG_TIP_PREHEAT)
+void tip_preheat_update(uint16_t typec_ma)
+{
+	// 扣除整板其他电路的电流
+	uint16_t ma = typec_ma > CONFIG_TIP_PREHEAT_RESERVE_MA
+			      ? typec_ma - CONFIG_TIP_PREHEAT_RESERVE_MA
+			      : 0;
+
+	tip_set_supply_limit(5000, ma);
+	if (ma > 0 && !tip_ctrl.heater_on) {
+		tip_ctrl.preheat = true;
+		tip_ctrl.heater_on = true;
+		LOG_INF("Preheat within %u mA", ma);
+	}
+}
+
+void tip_preheat_end(void)
+{
+	tip_ctrl.preheat = false;
+}
+#endif
+
+#if defined(CONFIG_TIP_HEATER_R_MEASUREMENT)
+static const struct device *ina226_dev = DEVICE_DT_GET(DT_ALIAS(ina226));
+
+static int ina226_read(int32_t *mv, int32_t *ma)
+{
+	struct sensor_value val;
+
+	if (sensor_sample_fetch_chan(ina226_dev, SENSOR_CHAN_ALL) < 0) {
+		return -EIO;
+	}
+	sensor_channel_get(ina226_dev, SENSOR_CHAN_VOLTAGE, &val);
+	*mv = sensor_value_to_milli(&val);
+	sensor_channel_get(ina226_dev, SENSOR_CHAN_CURRENT, &val);
+	*ma = sensor_value_to_milli(&val);
+	return 0;
+}
+
+// 测量前后电压相差超过1/10认为pd正在切换电压
+#define R_MEAS_VBUS_TOLERANCE_DIV 10
+// pd切换电压时重试，电源从接受请求到ps_ready最长约0.5s
+#define R_MEAS_ATTEMPTS  4
+#define R_MEAS_RETRY_MS  150
+
+static bool vbus_stable(int32_t mv0, int32_t mv)
+{
+	return abs(mv - mv0) <= mv0 / R_MEAS_VBUS_TOLERANCE_DIV;
+}
+
+/*
+ * 按低占空比加热一小段时间，平均电流不超过CONFIG_TIP_R_MEAS_CURRENT_MA，
+ * 用ina226测得的电流增量算出电阻: R = duty * V / (I_on - I_idle)
+ * pd在控制环路之前启动，测量可能和电压切换重叠，前后电压不一致时丢弃，返回-EAGAIN
+ */
+static int heater_measure_once(float *r_ohm)
+{
+	int32_t mv0, ma0, mv1, ma1;
+	uint16_t vbus_mv;
+
+	if (ina226_read(&mv0, &ma0) < 0 || mv0 < 3000) {
+		return -EIO;
+	}
+
+	uint32_t duty_q16 = (uint64_t)CONFIG_TIP_R_MEAS_CURRENT_MA * CONFIG_TIP_HEATER_RESISTANCE_MOHM *
+			    DUTY_Q16_ONE / 1000 / mv0;
+	duty_q16 = MIN(duty_q16, MAX_DUTY_Q16);
+
+	soldering_tip_pwm_set_duty_cycle(duty_q16);
+	// 等待ina226完成至少一次完整的平均转换
+	k_msleep(CONFIG_TIP_R_MEAS_PULSE_MS);
+	int ret = ina226_read(&mv1, &ma1);
+	soldering_tip_pwm_set_duty_cycle(0);
+	if (ret < 0) {
+		return ret;
+	}
+	// ina226是整个转换的平均值，再用每个pwm周期采样的vbus检查结束时的电压
+	if (!vbus_stable(mv0, mv1) ||
+	    (vbus_monitor_read_mv(&vbus_mv) == 0 && !vbus_stable(mv0, vbus_mv))) {
+		return -EAGAIN;
+	}
+
+	int32_t di = ma1 - ma0;
+	if (di <= 10) { // 烙铁头未插入或断路
+		return -ENOENT;
+	}
+	*r_ohm = (float)duty_q16 / DUTY_Q16_ONE * mv1 / di;
+	return 0;
+}
+
+static int heater_measure_resistance(struct controller *tip_ctrl)
+{
+	float r;
+	int ret = -EAGAIN;
+
+	if (!device_is_ready(ina226_dev)) {
+		return -ENODEV;
+	}
+	for (int i = 0; i < R_MEAS_ATTEMPTS && ret == -EAGAIN; i++) {
+		if (i > 0) {
+			k_msleep(R_MEAS_RETRY_MS);
+		}
+		ret = heater_measure_once(&r);
+	}
+	if (ret < 0) {
+		return ret;
+	}
+	// 和标称值相差太大认为测量无效
+	if (r < HEATER_R_MIN_OHM || r > HEATER_R_MAX_OHM) {
+		return -ERANGE;
+	}
+	tip_ctrl->heater_r_ohm = r;
+	return 0;
+}
+#endif
+
+void tip_adjust_setpoint(int32_t delta_c)
+{
+	// 单次32位写入，控制环路和界面读取时不会看到中间值
+	tip_ctrl.setpoint = CLAMP(tip_ctrl.setpoint + delta_c, SETPOINT_MIN_C, SETPOINT_MAX_C);
+}
+
+void tip_wake_up(void)
+{
+	if (!tip_ctrl.is_sleeping) {
+		return;
+	}
+	tip_ctrl.is_sleeping = false;
+#if defined(CONFIG_TIP_WAKE_BOOST)
+	tip_ctrl.wake_pending = true;
+#endif
+#if defined(CONFIG_CLOCK_SCALING)
+	clock_profile_kick();
+#endif
+#if defined(CONFIG_TIP_ADAPTIVE_SAMPLING)
+	// 唤醒后按快速采样，不用等调度器从慢速采样逐步切换
+	tip_ctrl.stable_count = 0;
+	tip_ctrl.sampling_rate = SAMPLING_FAST;
+	tip_ctrl.adc_cfg.period_ms = CONFIG_TIP_SAMPLING_FAST_PERIOD_MS;
+#endif
+}
+
+#if defined(CONFIG_TIP_ADAPTIVE_SAMPLING)
+static const uint16_t sampling_periods_ms[] = {
+	[SAMPLING_FAST] = CONFIG_TIP_SAMPLING_FAST_PERIOD_MS,
+	[SAMPLING_NORMAL] = CONFIG_TIP_SAMPLING_PERIOD_MS,
+	[SAMPLING_SLOW] = CONFIG_TIP_SAMPLING_SLOW_PERIOD_MS,
+};
+
+// 根据温度误差调整采样周期，升温和负载变化时加快采样，稳定后降低采样率减少关断时间
+static void sampling_schedule(struct controller *tip_ctrl, float error)
+{
+	enum sampling_rate rate;
+	float abs_err = fabsf(error);
+
+	if (!tip_ctrl->heater_on) {
+		tip_ctrl->stable_count = 0;
+		rate = SAMPLING_SLOW;
+	} else if (abs_err > CONFIG_TIP_SAMPLING_FAST_ERROR_C) {
+		tip_ctrl->stable_count = 0;
+		rate = SAMPLING_FAST;
+	} else if (abs_err > CONFIG_TIP_SAMPLING_STABLE_BAND_C) {
+		tip_ctrl->stable_count = 0;
+		rate = SAMPLING_NORMAL;
+	} else if (tip_ctrl->stable_count < CONFIG_TIP_SAMPLING_STABLE_COUNT) {
+		tip_ctrl->stable_count++;
+		// 从快速采样回到稳定区间时先过渡到正常采样
+		rate = tip_ctrl->sampling_rate == SAMPLING_FAST ? SAMPLING_NORMAL
+								: tip_ctrl->sampling_rate;
+	} else {
+		rate = SAMPLING_SLOW;
+	}
+
+	if (rate != tip_ctrl->sampling_rate) {
+		tip_ctrl->sampling_rate = rate;
+		// 在下一次counter回调中生效
+		tip_ctrl->adc_cfg.period_ms = sampling_periods_ms[rate];
+	}
+}
+#endif
+
+#if defined(CONFIG_TIP_TEMP_KALMAN)
+// 上一采样周期内的平均加热功率，扣除采样时mosfet关断的时间
+static float heater_power(const struct controller *tip_ctrl, uint16_t period_ms)
+{
+	float v = tip_ctrl->vbus_mv / 1000.0f;
+	float on_ratio = 1.0f - (float)tip_ctrl->settle_us / (period_ms * 1000.0f);
+
+	return (float)tip_ctrl->duty_q16 / DUTY_Q16_ONE * on_ratio * v * v / tip_ctrl->heater_r_ohm;
+}
+#endif
+
+static void filter_init(struct controller *tip_ctrl)
+{
+#if defined(CONFIG_TIP_FILTER_HAMPEL)
+	hampel_init(&tip_ctrl->hampel_ctx, CONFIG_TIP_FILTER_HAMPEL_WINDOW,
+		    CONFIG_TIP_FILTER_HAMPEL_K_10X, CONFIG_TIP_FILTER_HAMPEL_MIN_DEV_RAW);
+#endif
+	if (CONFIG_TIP_FILTER_MOVING_AVG_WINDOW > 1) {
+		moving_avg_init(&tip_ctrl->filter_ctx, CONFIG_TIP_FILTER_MOVING_AVG_WINDOW);
+	}
+}
+
+#if defined(CONFIG_TIP_FAULT_DETECTION)
+// 故障后重新开始滤波，去掉拔头前的采样；滑动平均先用这次的采样填满，不从0开始爬升
+static void filter_restart(struct controller *tip_ctrl, uint32_t raw)
+{
+	filter_init(tip_ctrl);
+	if (CONFIG_TIP_FILTER_MOVING_AVG_WINDOW > 1) {
+		moving_avg_set_value(&tip_ctrl->filter_ctx, raw);
+	}
+}
+
+// 在控制环路中执行，界面刷新在服务执行器中完成
+static void fault_notify(struct controller *tip_ctrl)
+{
+	uint8_t active = tip_ctrl->fault.active;
+
+	if (active != 0) {
+		LOG_WRN("Tip fault 0x%02x, heater off", active);
+	} else {
+		// 插回烙铁头后温度变化很大，重新初始化温度估计，pid无扰启动
+		LOG_INF("Tip fault cleared");
+		tip_ctrl->kf.inited = false;
+		tip_ctrl->pid_active = false;
+	}
+	if (tip_ctrl->fault_job != NULL) {
+		service_kick(tip_ctrl->fault_job);
+	}
+}
+#endif
+
 static void adc_work_handler(struct k_work *work)
 {
 	uint32_t temp_raw;
+
+#if defined(CONFIG_TIP_SETTLE_CALIBRATION)
+	// 只在pd协商完成、进入正常加热后测量，预热时占空比受type-c默认电流限制，
+	// 脉冲太弱测得的时间偏短；请求保留到那时再执行
+	if (tip_ctrl.settle_pending && tip_ctrl.heater_on && !tip_ctrl.preheat) {
+		settle_calibrate(&tip_ctrl);
+#if defined(CONFIG_DISPLAY_ADC_QUIET)
+		adc_quiet_end();
+#endif
+		return;
+	}
+#endif
 	// 执行adc 然后启动pwm
-	temp_read_adc_raw(&temp_raw);
+	int ret = temp_read_adc_raw(&temp_raw);
+#if defined(CONFIG_DISPLAY_ADC_QUIET)
+	adc_quiet_end();
+#endif
 
-	temp_raw = moving_avg_compute(&tip_ctrl.filter_ctx, temp_raw);
+	// 采样周期可变，pid采样时间跟随实际经过的周期
+	uint16_t elapsed = tip_ctrl.adc_cfg.elapsed_period_ms;
+	float meas;
+	float tt;
 
-	bool need_compute;
-#if ((CONFIG_PID_COMPUTE_INTERVAL / CONFIG_TIP_SAMPLING_PERIOD_MS) > 1)
-	static uint8_t c = 0;
-	c++;
-	if (c >= (CONFIG_PID_COMPUTE_INTERVAL / CONFIG_TIP_SAMPLING_PERIOD_MS)) {
-		c = 0;
-		need_compute = tip_ctrl.heater_on;
-	} else {
-		need_compute = false;
+#if defined(CONFIG_TIP_FAULT_DETECTION)
+	// duty_q16是刚结束的采样周期的占空比
+	uint8_t suspect = tip_fault_check_raw(&tip_ctrl.fault, ret, temp_raw, tip_ctrl.duty_q16 > 0);
+
+	suspect |= tip_fault_check_power(&tip_ctrl.fault, tip_ctrl.duty_q16, tip_ctrl.ina_seq,
+					 tip_ctrl.ina_vbus_mv, tip_ctrl.ina_power_mw,
+					 tip_ctrl.heater_r_ohm);
+	if ((suspect & TIP_FAULT_RAW) == 0) {
+		if (!tip_ctrl.fault.last_valid) {
+			filter_restart(&tip_ctrl, temp_raw);
+		}
+		temp_raw = filter_chain_compute(&tip_ctrl.filter, temp_raw);
+		meas = temp_raw_to_temperature(temp_raw);
+		suspect |= tip_fault_check_temp(&tip_ctrl.fault, meas, elapsed);
+	}
+	if (tip_fault_update(&tip_ctrl.fault, suspect)) {
+		fault_notify(&tip_ctrl);
 	}
+	// 可疑的采样在本周期就关断加热，不进入估计和pid
+	if (suspect != 0 || tip_ctrl.fault.active != 0) {
+		tip_ctrl.pid_active = false;
+		tip_ctrl.boost_active = false;
+		tip_ctrl.power_cmd_w = 0;
+		heater_apply(&tip_ctrl, 0);
+		return;
+	}
+#else
+	ARG_UNUSED(ret);
+	temp_raw = filter_chain_compute(&tip_ctrl.filter, temp_raw);
+	meas = temp_raw_to_temperature(temp_raw);
+#endif
+
+#if defined(CONFIG_TIP_TEMP_KALMAN)
+	float power_w = heater_power(&tip_ctrl, elapsed);
+	tt = temp_kf_update(&tip_ctrl.kf, meas, power_w, get_cool_temp(), elapsed / 1000.0f);
+	tip_ctrl.temp_rate = tip_ctrl.kf.rate;
 #else
-	need_compute = tip_ctrl.heater_on;
+	tt = meas;
+#endif
+
+	// pid的反馈温度，开启smith预估器时补偿测量延时
+	float pid_in = tt;
+#if defined(CONFIG_TIP_SMITH_PREDICTOR)
+	smith_identify_update(&tip_ctrl.smith, tt, power_w, elapsed);
+	pid_in += smith_update(&tip_ctrl.smith, power_w, elapsed);
 #endif
 
-	float tt = temp_raw_to_temperature(temp_raw);
+	// 预热阶段只加热到休眠温度
+	float target = tip_ctrl.is_sleeping || tip_ctrl.preheat ? tip_ctrl.sleep_setpoint
+								  : tip_ctrl.setpoint;
 	tip_ctrl.cur_temp = tt;
-	if (need_compute) {
-		pid_compute(&tip_ctrl.pid, tt,
-			    tip_ctrl.is_sleeping ? tip_ctrl.sleep_setpoint : tip_ctrl.setpoint);
+	if (tip_ctrl.heater_on) {
+		if (!tip_ctrl.pid_active) {
+#if defined(CONFIG_TIP_SMITH_PREDICTOR)
+			float rise = tt - get_cool_temp();
+			smith_reset(&tip_ctrl.smith, rise);
+			// 冷态开始加热时重新辨识死区时间
+			if (rise < SMITH_IDENT_MAX_RISE_C) {
+				smith_identify_start(&tip_ctrl.smith, tt);
+			}
+			pid_in = tt;
+#endif
+			// 开始加热时无扰启动，丢弃上次停止时残留的积分
+			pid_reset(&tip_ctrl.pid, pid_in, target, 0);
+			tip_ctrl.pid_active = true;
+		}
+		if (elapsed != tip_ctrl.pid.sample_time) {
+			pid_set_sample_time(&tip_ctrl.pid, elapsed);
+		}
+#if defined(CONFIG_PID_GAIN_SCHEDULING)
+		pid_schedule_update(&tip_ctrl.pid, &tip_ctrl.gain_sched, target, target - pid_in);
+#endif
+		pid_compute(&tip_ctrl.pid, pid_in, target);
+	} else {
+		tip_ctrl.pid_active = false;
 	}
 
+#if defined(TIP_BOOST)
+	hold_output_track(&tip_ctrl, tt, target);
+#if defined(CONFIG_TIP_WAKE_BOOST)
+	wake_boost_update(&tip_ctrl, tt, target);
+#endif
+#if defined(CONFIG_TIP_LOAD_BOOST)
+	load_boost_update(&tip_ctrl, tt, target);
+#endif
+	boost_update(&tip_ctrl, tt, target);
+#endif
+
+#if defined(CONFIG_TIP_ADAPTIVE_SAMPLING)
+	sampling_schedule(&tip_ctrl, target - tt);
+#endif
+
 	heater_update(&tip_ctrl);
+#if defined(CONFIG_UI_TREND)
+	trend_record(tt, target, tip_ctrl.duty_q16, elapsed);
+#endif
 }
 
 K_WORK_DEFINE(adc_work, adc_work_handler);
@@ -107,15 +1058,36 @@ static void tip_adc_counter_callback(const struct device *dev, uint8_t chan_id,
 				     void *user_data)
 {
 	struct tip_adc_counter_config *tip_adc_cfg = user_data;
+	int ret;
 	// 关闭烙铁pwm
 	heater_off();
 
 	// 等待mosfet完全关断执行adc
-	counter_set_channel_alarm(dev, TIP_ADC_DELAY_CHAN, &tip_adc_cfg->delay_cfg);
+	ret = counter_set_channel_alarm(dev, TIP_ADC_DELAY_CHAN, &tip_adc_cfg->delay_cfg);
+	if (ret != 0) {
+		sampling_stop(&tip_ctrl, ret);
+		return;
+	}
+
+	// 记录刚结束的采样周期，并按调度器给出的周期设置下一次
+	tip_adc_cfg->elapsed_period_ms = tip_adc_cfg->armed_period_ms;
+	if (tip_adc_cfg->armed_period_ms != tip_adc_cfg->period_ms) {
+		tip_adc_cfg->armed_period_ms = tip_adc_cfg->period_ms;
+		tip_adc_cfg->sampling_cfg.ticks =
+			counter_us_to_ticks(dev, tip_adc_cfg->armed_period_ms * 1000);
+	}
+#if defined(CONFIG_DISPLAY_ADC_QUIET)
+	// 到adc转换结束前屏幕不开始新的spi传输
+	adc_quiet_begin(tip_adc_cfg->armed_period_ms * 1000);
+#endif
 
 	// 触发下一次计数
 	// 因为执行adc时间远小于两次adc间隔,所以直接这里触发
-	counter_set_channel_alarm(dev, TIP_ADC_COUNTER_CHAN, &tip_adc_cfg->sampling_cfg);
+	ret = counter_set_channel_alarm(dev, TIP_ADC_COUNTER_CHAN, &tip_adc_cfg->sampling_cfg);
+	if (ret != 0) {
+		// 已经设置的延时通道还会执行一次adc任务，heater_apply检查标志不再加热
+		sampling_stop(&tip_ctrl, ret);
+	}
 }
 
 static void tip_adc_delay_callback(const struct device *dev, uint8_t chan_id, uint32_t ticks,
@@ -147,19 +1119,101 @@ int init_tip_controller(struct app *app)
 		LOG_ERR("PWM device not ready");
 		return -ENODEV;
 	}
-	moving_avg_init(&tip_ctrl.filter_ctx, 2);
+	ret = soldering_tip_pwm_init();
+	if (ret != 0) {
+		LOG_ERR("PWM cycles query failed: %d", ret);
+		return ret;
+	}
+	// 采样滤波链：去尖峰 -> 滑动平均
+	filter_chain_init(&tip_ctrl.filter);
+	filter_init(&tip_ctrl);
+#if defined(CONFIG_TIP_FILTER_HAMPEL)
+	filter_chain_add(&tip_ctrl.filter, filter_stage_hampel, &tip_ctrl.hampel_ctx);
+#endif
+	if (CONFIG_TIP_FILTER_MOVING_AVG_WINDOW > 1) {
+		filter_chain_add(&tip_ctrl.filter, filter_stage_moving_avg, &tip_ctrl.filter_ctx);
+	}
+	temp_kf_init(&tip_ctrl.kf, TIP_KF_CFG(HEAT_GAIN), TIP_KF_CFG(LOSS), TIP_KF_CFG(TEMP_NOISE),
+		     TIP_KF_CFG(RATE_NOISE), TIP_KF_CFG(MEAS_NOISE));
+#if defined(CONFIG_TIP_SMITH_PREDICTOR)
+	smith_init(&tip_ctrl.smith, TIP_KF_CFG(HEAT_GAIN), TIP_KF_CFG(LOSS),
+		   CONFIG_TIP_SMITH_DEAD_TIME_MS, SMITH_MAX_DEAD_MS);
+#endif
+	tip_ctrl.duty_q16 = 0;
+	tip_ctrl.vbus_mv = 0;
+	tip_ctrl.power_cmd_w = 0;
+	tip_ctrl.heater_r_ohm = HEATER_R_OHM;
+	tip_ctrl.duty_limit_q16 = MAX_DUTY_Q16;
+	tip_ctrl.ina_fresh = false;
+	tip_ctrl.ina_seq = 0;
+#if defined(CONFIG_TIP_FAULT_DETECTION)
+	tip_fault_init(&tip_ctrl.fault, temp_adc_raw_max());
+#endif
+	// 屏幕初始化后由界面设置
+	tip_ctrl.fault_job = NULL;
 	tip_ctrl.setpoint = CONFIG_RUNNING_SETPOINT_C;
 	tip_ctrl.heater_on = false;
+	tip_ctrl.preheat = false;
 	tip_ctrl.sleep_setpoint = CONFIG_SLEEPING_SETPOINT_C;
 	tip_ctrl.is_sleeping = false;
+	tip_ctrl.sampling_rate = SAMPLING_NORMAL;
+	tip_ctrl.stable_count = 0;
+
+	// 优先使用保存的稳定时间，开机后第一次加热时重新测量
+	// 超出测量范围的值（损坏或未保存）不用
+	tip_ctrl.settle_us = CONFIG_MOSFET_OFF_DELAY_US;
+	if (tip_settings_init() == 0) {
+		uint16_t saved_us = tip_settings_get()->settle_us;
 
-	pid_init(&tip_ctrl.pid, PID_KP, PID_KI, PID_KD, CONFIG_PID_COMPUTE_INTERVAL_MS,
+		if (saved_us >= SETTLE_MIN_US && saved_us <= SETTLE_MAX_US) {
+			tip_ctrl.settle_us = saved_us;
+		} else if (saved_us != 0) {
+			LOG_WRN("Saved settle time %u us out of range, use default", saved_us);
+		}
+	}
+	tip_ctrl.settle_pending = IS_ENABLED(CONFIG_TIP_SETTLE_CALIBRATION);
+
+	pid_init(&tip_ctrl.pid, PID_KP, PID_KI, PID_KD, CONFIG_TIP_SAMPLING_PERIOD_MS,
 		 PID_CD_DIRECT);
 	pid_set_output_limits(&tip_ctrl.pid, 0, PID_MAX_OUTPUT);
+	pid_set_setpoint_weights(&tip_ctrl.pid, CONFIG_PID_SP_WEIGHT_P_100X / 100.0f,
+				 CONFIG_PID_SP_WEIGHT_D_100X / 100.0f);
+	pid_set_derivative_filter(&tip_ctrl.pid, CONFIG_PID_D_FILTER_N);
+	pid_set_tracking_gain(&tip_ctrl.pid, CONFIG_PID_KT_1000X / 1000.0f);
+	tip_ctrl.pid_active = false;
+	tip_ctrl.boost_active = false;
+	tip_ctrl.wake_pending = false;
+	tip_ctrl.hold_output = 0;
+	tip_ctrl.hold_target = 0;
+	tip_ctrl.load = (struct load_detector){0};
+
+#if defined(CONFIG_PID_GAIN_SCHEDULING)
+	if (tip_settings_get()->gains_valid) {
+		tip_ctrl.gain_sched = tip_settings_get()->gains;
+		tip_ctrl.gain_sched.blend = 0;
+	} else {
+		pid_schedule_init(&tip_ctrl.gain_sched, default_hold_gains, default_heat_gains,
+				  ARRAY_SIZE(default_hold_gains), CONFIG_PID_SCHED_HEAT_BAND_C);
+	}
+#endif
+
+#if defined(CONFIG_TIP_HEATER_R_MEASUREMENT)
+	// 采样定时器启动前测量，避免和控制环路抢pwm
+	int r_ret = heater_measure_resistance(&tip_ctrl);
+	if (r_ret == 0) {
+		LOG_INF("Heater resistance %d mOhm", (int)(tip_ctrl.heater_r_ohm * 1000));
+	} else {
+		LOG_WRN("Heater resistance measurement failed (%d), use nominal", r_ret);
+	}
+#endif
 
 	counter_start(tip_adc_counter_dev);
+	service_add(&cjc_job, CJC_REFRESH_PERIOD_MS, CJC_REFRESH_PERIOD_MS);
 
 	// 对热电偶进行采样
+	tip_ctrl.adc_cfg.period_ms = CONFIG_TIP_SAMPLING_PERIOD_MS;
+	tip_ctrl.adc_cfg.armed_period_ms = CONFIG_TIP_SAMPLING_PERIOD_MS;
+	tip_ctrl.adc_cfg.elapsed_period_ms = CONFIG_TIP_SAMPLING_PERIOD_MS;
 	tip_ctrl.adc_cfg.sampling_cfg.flags = 0;
 	tip_ctrl.adc_cfg.sampling_cfg.ticks =
 		counter_us_to_ticks(tip_adc_counter_dev, CONFIG_TIP_SAMPLING_PERIOD_MS * 1000);
@@ -169,7 +1223,7 @@ int init_tip_controller(struct app *app)
 	// 等待mos完全关断延时配置
 	tip_ctrl.adc_cfg.delay_cfg.flags = 0;
 	tip_ctrl.adc_cfg.delay_cfg.ticks =
-		counter_us_to_ticks(tip_adc_counter_dev, CONFIG_MOSFET_OFF_DELAY_US);
+		counter_us_to_ticks(tip_adc_counter_dev, tip_ctrl.settle_us);
 	tip_ctrl.adc_cfg.delay_cfg.callback = tip_adc_delay_callback;
 	tip_ctrl.adc_cfg.delay_cfg.user_data = &tip_ctrl.adc_cfg;
 
@@ -8,35 +8,149 @@
 
 #include "moving_average.h"
 #include "pid_controller.h"
+#include "sample_filter.h"
+#include "temp_estimator.h"
+#include "smith_predictor.h"
+#include "tip_fault.h"
 
+struct service_job;
 
 struct tip_adc_counter_config {
   // 烙铁头每隔一段时间触发adc
   struct counter_alarm_cfg sampling_cfg;
   // adc计数触发后，延迟一些时间等待mosfet关断,执行adc
   struct counter_alarm_cfg delay_cfg;
+  uint16_t period_ms;         // 调度器期望的采样周期
+  uint16_t armed_period_ms;   // 当前已设置到counter的采样周期
+  uint16_t elapsed_period_ms; // 本次采样实际经过的周期
+};
+
+enum sampling_rate {
+  SAMPLING_FAST,   // 升温或误差较大
+  SAMPLING_NORMAL,
+  SAMPLING_SLOW,   // 温度稳定
+};
+
+// 焊接负载检测和统计
+struct load_detector {
+  bool armed;               // 已稳定在目标温度，可以检测负载
+  bool in_event;
+  float last_temp;
+  float power_baseline_mw;  // 稳定时的ina226功率基线
+  uint32_t ina_seq;         // 已处理的ina226读数序号，只用新读数更新基线和判断功率上升
+  uint32_t start_ms;
+  float max_sag_c;
+  uint32_t events;
+  uint32_t last_recovery_ms;
+  uint32_t max_recovery_ms;
+  uint32_t total_recovery_ms;
 };
 
 struct controller {
   struct tip_adc_counter_config adc_cfg;
+  filter_chain filter;
+  hampel_filter_ctx hampel_ctx;
   moving_avg_filter_ctx filter_ctx;
+  temp_kf kf;
+  smith_predictor smith;
   struct pid_controller pid;
+  bool pid_active;      // pid是否在控制中，开始加热时无扰启动
+  pid_gain_schedule gain_sched;
+  // 前馈加热，期间用boost_output代替pid输出
+  bool boost_active;
+  float boost_output;
+  uint32_t boost_end_ms;
+  bool wake_pending;        // 从休眠唤醒，等待计算唤醒加热
+  float hold_output;        // 目标温度下的保温输出，boost结束后预置到积分项
+  float hold_target;
+  struct load_detector load;
   float cur_temp; // 当前温度
+  float temp_rate; // 当前升温速率（℃/s）
   float setpoint;     // 设置温度
   bool is_sleeping;
   float sleep_setpoint;     // 休眠模式设置温度
   bool heater_on;
+  bool preheat;             // pd协商完成前用type-c默认电流预热
+  uint32_t duty_q16;    // 当前pwm占空比（Q16，65536为100%）
+  uint16_t vbus_mv;     // 最近一次测得的vbus电压
+  // 功率内环
+  float power_cmd_w;    // 外环（温度pid）给出的目标功率
+  float heater_r_ohm;   // 根据ina226测量修正的发热芯等效电阻
+  uint32_t duty_limit_q16;  // 电源档位电流限制对应的最大占空比
+  uint16_t ina_vbus_mv; // ina226测得的电压和功率，由i2c总线线程更新
+  uint32_t ina_power_mw;
+  bool ina_fresh;
+  uint32_t ina_seq;     // ina226读数的序号，每次读取完成加1
+  // 故障检测，故障出现或清除时在服务执行器中通知界面
+  struct tip_fault fault;
+  struct service_job *fault_job;
+  enum sampling_rate sampling_rate;
+  uint8_t stable_count; // 连续处于稳定区间的采样次数
+  uint16_t settle_us;   // mosfet关断到adc采样的延时
+  bool settle_pending;  // 下次采样时测量稳定时间
+  bool sampling_stopped; // 采样定时器设置失败，不再闭环，保持关断加热
 };
 
+// 占空比用Q16小数表示
+#define DUTY_Q16_ONE            (1u << 16)
+#define DUTY_PERCENT_TO_Q16(p)  ((uint32_t)(p) * DUTY_Q16_ONE / 100)
+#define MAX_DUTY_Q16            DUTY_PERCENT_TO_Q16(CONFIG_MAX_DUTY_CYCLE)
+
+// 工作温度可调范围（℃）
+#define SETPOINT_MIN_C          150
+#define SETPOINT_MAX_C          450
+
+// 采样时临时关断，不影响sigma-delta累积误差
 #define heater_off()                                                           \
   do {                                                                         \
-    soldering_tip_pwm_set_duty_cycle(0);                                       \
+    soldering_tip_pwm_off();                                                   \
   } while (0)
 
-int soldering_tip_pwm_set_duty_cycle(uint8_t percent);
+int soldering_tip_pwm_set_duty_cycle(uint32_t duty_q16);
+
+int soldering_tip_pwm_off(void);
+
+// 系统时钟降频后按分频系数重新计算pwm周期数，保持pwm频率不变
+void soldering_tip_pwm_set_clock_div(uint32_t div);
+
+// vbus跌落时在中断里立即把pwm输出强制为无效电平，恢复后回到pwm模式
+void soldering_tip_pwm_force_off(bool force);
 
 struct app;
 
 int init_tip_controller(struct app *app);
 
+void tip_request_settle_calibration(void);
+
+// 按电源电压和允许电流限制加热占空比，mv为0表示不限制
+void tip_set_supply_limit(uint16_t mv, uint16_t ma);
+
+// type-c广播的默认电流变化时更新预热电流预算，必要时开始预热
+void tip_preheat_update(uint16_t typec_ma);
+
+// 进入工作界面，结束预热
+void tip_preheat_end(void);
+
+// 深度睡眠前关闭加热并停止采样定时器，唤醒后恢复
+void tip_suspend(void);
+void tip_resume(void);
+
+// 调整工作温度，限制在SETPOINT_MIN_C~SETPOINT_MAX_C，下一次采样生效
+// 运行时只在按键上报上下文调用，不会阻塞
+void tip_adjust_setpoint(int32_t delta_c);
+
+// 从休眠唤醒，立即切换到工作温度并前馈加热
+void tip_wake_up(void);
+
+#if defined(CONFIG_TIP_LOAD_BOOST)
+// 负载事件次数和恢复时间统计
+const struct load_detector *tip_load_stats(void);
+#endif
+
+// 当前设定温度附近的保温增益（增益表中的值）
+void tip_get_hold_gains(float *kp, float *ki, float *kd);
+
+// 调整当前设定温度附近的保温增益，停止调整后延时保存
+void tip_set_hold_gains(float kp, float ki, float kd);
+
 #endif // __HEATER_CONTROLLER_H
@@ -0,0 +1,145 @@
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/rtio/rtio.h>
+#include <zephyr/logging/log.h>
+
+#include "i2c_bus.h"
+#include "service.h"
+
+LOG_MODULE_REGISTER(i2c_bus, LOG_LEVEL_INF);
+
+// 总线线程比服务执行器优先，提交后不用等执行器空闲
+#define I2C_BUS_THREAD_PRIORITY K_PRIO_COOP(1)
+#define I2C_BUS_STACK_SIZE      768
+
+// 统计信息输出周期
+#define I2C_BUS_STATS_PERIOD_MS (60 * 1000)
+
+// 一次只执行一个事务，事务内最多4条消息
+RTIO_DEFINE(i2c_bus_rtio, 4, 4);
+
+STAILQ_HEAD(i2c_bus_queue, i2c_bus_req);
+static struct i2c_bus_queue queues[I2C_BUS_PRIO_COUNT] = {
+	STAILQ_HEAD_INITIALIZER(queues[I2C_BUS_PRIO_HIGH]),
+	STAILQ_HEAD_INITIALIZER(queues[I2C_BUS_PRIO_LOW]),
+};
+static struct k_spinlock lock;
+static K_SEM_DEFINE(bus_sem, 0, K_SEM_MAX_LIMIT);
+
+// 总线占用时间统计
+static uint64_t busy_cyc;
+static uint32_t stats_start_ms;
+static uint32_t max_latency_us[I2C_BUS_PRIO_COUNT];
+
+int i2c_bus_submit(struct i2c_bus_req *req)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	if (req->pending) {
+		k_spin_unlock(&lock, key);
+		return -EBUSY;
+	}
+	req->pending = true;
+	req->submit_cyc = k_cycle_get_32();
+	STAILQ_INSERT_TAIL(&queues[req->prio], req, entry);
+	k_spin_unlock(&lock, key);
+	k_sem_give(&bus_sem);
+	return 0;
+}
+
+// 取优先级最高的请求
+static struct i2c_bus_req *next_req(void)
+{
+	struct i2c_bus_req *req = NULL;
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	for (int i = 0; i < I2C_BUS_PRIO_COUNT; i++) {
+		req = STAILQ_FIRST(&queues[i]);
+		if (req != NULL) {
+			STAILQ_REMOVE_HEAD(&queues[i], entry);
+			break;
+		}
+	}
+	k_spin_unlock(&lock, key);
+	return req;
+}
+
+static int transfer(struct i2c_bus_req *req)
+{
+	struct rtio_sqe *sqe =
+		i2c_rtio_copy(&i2c_bus_rtio, req->iodev, req->msgs, req->num_msgs);
+	struct rtio_cqe *cqe;
+	int result = 0;
+
+	if (sqe == NULL) {
+		return -ENOMEM;
+	}
+	// 等待整个事务完成，同一事务的消息各产生一个完成事件
+	rtio_submit(&i2c_bus_rtio, req->num_msgs);
+	while ((cqe = rtio_cqe_consume(&i2c_bus_rtio)) != NULL) {
+		if (cqe->result < 0 && result == 0) {
+			result = cqe->result;
+		}
+		rtio_cqe_release(&i2c_bus_rtio, cqe);
+	}
+	return result;
+}
+
+static void i2c_bus_thread(void *p1, void *p2, void *p3)
+{
+	struct i2c_bus_req *req;
+
+	stats_start_ms = k_uptime_get_32();
+	while (true) {
+		k_sem_take(&bus_sem, K_FOREVER);
+		req = next_req();
+		if (req == NULL) {
+			continue;
+		}
+
+		uint32_t start = k_cycle_get_32();
+		int result = transfer(req);
+		uint32_t end = k_cycle_get_32();
+		uint32_t latency_us = k_cyc_to_us_ceil32(end - req->submit_cyc);
+
+		busy_cyc += end - start;
+		req->count++;
+		if (result < 0) {
+			req->errors++;
+		}
+		req->max_latency_us = MAX(req->max_latency_us, latency_us);
+		max_latency_us[req->prio] = MAX(max_latency_us[req->prio], latency_us);
+
+		// 回调中可以再次提交
+		req->pending = false;
+		req->done(req, result);
+	}
+}
+
+K_THREAD_DEFINE(i2c_bus_tid, I2C_BUS_STACK_SIZE, i2c_bus_thread, NULL, NULL, NULL,
+		I2C_BUS_THREAD_PRIORITY, 0, 0);
+
+void i2c_bus_log_stats(void)
+{
+	uint32_t elapsed_ms = k_uptime_get_32() - stats_start_ms;
+
+	if (elapsed_ms == 0) {
+		return;
+	}
+	LOG_INF("i2c busy %u us/s, max latency high %u us low %u us",
+		(uint32_t)(k_cyc_to_us_floor64(busy_cyc) * 1000 / elapsed_ms),
+		max_latency_us[I2C_BUS_PRIO_HIGH], max_latency_us[I2C_BUS_PRIO_LOW]);
+}
+
+static void stats_handler(struct service_job *job)
+{
+	i2c_bus_log_stats();
+}
+
+static struct service_job stats_job = SERVICE_JOB_INITIALIZER("i2c stats", stats_handler);
+
+void i2c_bus_init(void)
+{
+	service_add(&stats_job, I2C_BUS_STATS_PERIOD_MS, I2C_BUS_STATS_PERIOD_MS);
+}
@@ -0,0 +1,54 @@
+#ifndef __I2C_BUS_H
+#define __I2C_BUS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/rtio/rtio.h>
+
+#include "queque.h"
+
+/*
+ * i2c2总线调度：ina226和lis2dw12的读取都提交到总线线程，按优先级排队，
+ * 通过rtio执行，完成后在总线线程中回调。
+ * 每次只执行一个事务，高优先级的请求在当前事务结束后马上执行。
+ */
+enum i2c_bus_prio {
+  I2C_BUS_PRIO_HIGH, // 功率读取，控制环路和功率限制使用
+  I2C_BUS_PRIO_LOW,  // 加速度计
+  I2C_BUS_PRIO_COUNT,
+};
+
+struct i2c_bus_req {
+  STAILQ_ENTRY(i2c_bus_req) entry;
+  struct rtio_iodev *iodev;
+  struct i2c_msg *msgs;
+  uint8_t num_msgs;
+  enum i2c_bus_prio prio;
+  // 在总线线程中调用，result为负数表示失败
+  void (*done)(struct i2c_bus_req *req, int result);
+  bool pending;
+  uint32_t submit_cyc;
+  // 统计
+  uint32_t count;
+  uint32_t errors;
+  uint32_t max_latency_us; // 提交到完成的最长时间
+};
+
+/**
+ * @brief 注册周期统计输出，总线线程在启动时已经运行
+ */
+void i2c_bus_init(void);
+
+/**
+ * @brief 提交请求，不等待，可以在其他线程和中断里调用
+ * @retval -EBUSY 上一次提交的请求还没完成
+ */
+int i2c_bus_submit(struct i2c_bus_req *req);
+
+/**
+ * @brief 输出每秒总线占用时间和各请求的最长延迟
+ */
+void i2c_bus_log_stats(void);
+
+#endif // __I2C_BUS_H
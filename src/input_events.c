@@ -0,0 +1,204 @@
+
+#include <zephyr/kernel.h>
+#include <zephyr/input/input.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/logging/log.h>
+
+#include "app_ui.h"
+#include "heater_controller.h"
+#include "input_events.h"
+#include "service.h"
+
+LOG_MODULE_REGISTER(input_events, LOG_LEVEL_INF);
+
+// 每次按键调整的温度（℃）
+#define SETPOINT_STEP_C 10
+
+// 队列长度，必须是2的幂
+#define INPUT_QUEUE_SIZE 16
+BUILD_ASSERT(IS_POWER_OF_TWO(INPUT_QUEUE_SIZE), "input queue size must be a power of two");
+
+/*
+ * 单生产者单消费者无锁队列，生产者只修改head，消费者只修改tail，
+ * atomic_set带内存屏障，先写入事件再发布head
+ */
+static uint8_t queue[INPUT_QUEUE_SIZE];
+static atomic_t head;
+static atomic_t tail;
+static atomic_t dropped;
+
+static struct app *input_app;
+
+static bool queue_put(enum event evt)
+{
+	atomic_val_t h = atomic_get(&head);
+
+	if (h - atomic_get(&tail) >= INPUT_QUEUE_SIZE) {
+		atomic_inc(&dropped);
+		return false;
+	}
+	queue[h & (INPUT_QUEUE_SIZE - 1)] = evt;
+	atomic_set(&head, h + 1);
+	return true;
+}
+
+static bool queue_get(enum event *evt)
+{
+	atomic_val_t t = atomic_get(&tail);
+
+	if (t == atomic_get(&head)) {
+		return false;
+	}
+	*evt = queue[t & (INPUT_QUEUE_SIZE - 1)];
+	atomic_set(&tail, t + 1);
+	return true;
+}
+
+uint32_t input_events_dropped(void)
+{
+	return (uint32_t)atomic_get(&dropped);
+}
+
+static void input_handler(struct service_job *job)
+{
+	enum event evt;
+
+	while (queue_get(&evt)) {
+		app_event_handler(input_app, evt);
+	}
+}
+
+static struct service_job input_job = SERVICE_JOB_INITIALIZER("input", input_handler);
+
+// 主界面时直接调整设定温度，控制环路下一次采样就使用新值，界面只需刷新
+static bool setpoint_step(int32_t steps)
+{
+	if (!atomic_get(&input_app->setpoint_input)) {
+		return false;
+	}
+	tip_adjust_setpoint(steps * SETPOINT_STEP_C);
+	service_kick(&input_app->draw_job);
+	return true;
+}
+
+#if defined(CONFIG_UI_KEY_REPEAT)
+/*
+ * 连按加速：按长按会切换界面，所以在短按后REPEAT_TAP_MS内再次按住才开始自动重复，
+ * 重复间隔逐渐缩短，这次按键的短按和长按事件都忽略
+ */
+#define REPEAT_TAP_MS       300
+#define REPEAT_DELAY_MS     300
+#define REPEAT_START_MS     250
+#define REPEAT_MIN_MS       50
+
+enum {
+	KEY_UP_IDX,
+	KEY_DOWN_IDX,
+	KEY_COUNT,
+};
+
+static uint32_t last_tap_ms[KEY_COUNT];
+static bool suppress[KEY_COUNT];
+static int repeat_key = -1;
+static uint32_t repeat_interval_ms;
+
+static void repeat_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(repeat_work, repeat_handler);
+
+static void repeat_handler(struct k_work *work)
+{
+	if (repeat_key < 0 || !setpoint_step(repeat_key == KEY_UP_IDX ? 1 : -1)) {
+		repeat_key = -1;
+		return;
+	}
+	suppress[repeat_key] = true;
+	k_work_schedule(&repeat_work, K_MSEC(repeat_interval_ms));
+	repeat_interval_ms = MAX(repeat_interval_ms * 3 / 4, REPEAT_MIN_MS);
+}
+
+// 处理按键原始的按下和松开，短按后马上再次按住时准备自动重复
+static void repeat_raw_key(int key, bool pressed)
+{
+	if (pressed) {
+		suppress[key] = false;
+		if (k_uptime_get_32() - last_tap_ms[key] < REPEAT_TAP_MS &&
+		    atomic_get(&input_app->setpoint_input)) {
+			repeat_key = key;
+			repeat_interval_ms = REPEAT_START_MS;
+			k_work_schedule(&repeat_work, K_MSEC(REPEAT_DELAY_MS));
+		}
+	} else if (key == repeat_key) {
+		repeat_key = -1;
+		k_work_cancel_delayable(&repeat_work);
+	}
+}
+
+static int key_index(uint16_t code)
+{
+	switch (code) {
+	case INPUT_KEY_0:
+	case INPUT_KEY_A:
+	case INPUT_KEY_X:
+		return KEY_UP_IDX;
+	case INPUT_KEY_1:
+	case INPUT_KEY_B:
+	case INPUT_KEY_Y:
+		return KEY_DOWN_IDX;
+	default:
+		return -1;
+	}
+}
+#endif
+
+static void input_cb(struct input_event *evt, void *user_data)
+{
+	enum event app_evt;
+
+	if (input_app == NULL) {
+		return;
+	}
+#if defined(CONFIG_UI_KEY_REPEAT)
+	int key = key_index(evt->code);
+
+	if (evt->code == INPUT_KEY_0 || evt->code == INPUT_KEY_1) {
+		repeat_raw_key(key, evt->value);
+		return;
+	}
+	if (key >= 0 && suppress[key]) {
+		return;
+	}
+#endif
+	if (!evt->value) { // 只处理按下
+		return;
+	}
+	if (evt->code == INPUT_KEY_A) {
+		app_evt = EVT_UP;
+	} else if (evt->code == INPUT_KEY_B) {
+		app_evt = EVT_DOWN;
+	} else if (evt->code == INPUT_KEY_X) {
+		app_evt = EVT_NEXT;
+	} else if (evt->code == INPUT_KEY_Y) {
+		app_evt = EVT_OK;
+	} else {
+		return;
+	}
+#if defined(CONFIG_UI_KEY_REPEAT)
+	if (app_evt == EVT_UP || app_evt == EVT_DOWN) {
+		last_tap_ms[key] = k_uptime_get_32();
+	}
+#endif
+	if ((app_evt == EVT_UP && setpoint_step(1)) || (app_evt == EVT_DOWN && setpoint_step(-1))) {
+		return;
+	}
+	// 输入上下文不能等待，队列满时丢弃
+	if (queue_put(app_evt)) {
+		service_kick(&input_job);
+	}
+}
+
+INPUT_CALLBACK_DEFINE(NULL, input_cb, NULL);
+
+void input_events_init(struct app *app)
+{
+	input_app = app;
+}
@@ -0,0 +1,18 @@
+#ifndef __INPUT_EVENTS_H
+#define __INPUT_EVENTS_H
+
+#include <stdint.h>
+
+struct app;
+
+/*
+ * 按键处理：输入上报上下文（按键轮询和长按都在系统工作队列）只做不会阻塞的操作，
+ * 事件放入单生产者单消费者无锁队列，由服务执行器交给界面处理。
+ * 主界面的UP/DOWN直接调整设定温度，不经过队列，多次按键只触发一次刷新。
+ */
+void input_events_init(struct app *app);
+
+// 队列满丢弃的事件数
+uint32_t input_events_dropped(void);
+
+#endif // __INPUT_EVENTS_H
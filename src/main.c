@@ -8,7 +8,6 @@
 #include <zephyr/sys/printk.h>
 
 #include <zephyr/drivers/i2c.h>
-#include <zephyr/input/input.h>
 
 #include <zephyr/drivers/usb_c/usbc_pd.h>
 #include <zephyr/drivers/usb_c/usbc_tc.h>
@@ -20,47 +19,57 @@
 #include "heater_controller.h"
 #include "temperature_adc.h"
 #include "sleep_detection.h"
+#include "boot_time.h"
+#include "service.h"
+#include "input_events.h"
+#include "i2c_bus.h"
+#include "clock_profile.h"
+#include "adc_quiet.h"
+#include "vbus_monitor.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(main, LOG_LEVEL_DBG);
 
 static struct app app;
 
-static void input_cb(struct input_event *evt, void *user_data)
-{
-	if (evt->value) { // press down
-		if (evt->code == INPUT_KEY_A) {
-			app_event_handler(&app, EVT_UP);
-		} else if (evt->code == INPUT_KEY_B) {
-			app_event_handler(&app, EVT_DOWN);
-		} else if (evt->code == INPUT_KEY_X) {
-			app_event_handler(&app, EVT_NEXT);
-		} else if (evt->code == INPUT_KEY_Y) {
-			app_event_handler(&app, EVT_OK);
-		}
-	}
-}
-
-INPUT_CALLBACK_DEFINE(NULL, input_cb, NULL);
-
-
 int main(void)
 {
+	boot_mark(BOOT_STAGE_MAIN);
 	app_init(&app);
+	input_events_init(&app);
+	i2c_bus_init();
+#if defined(CONFIG_DISPLAY_ADC_QUIET)
+	adc_quiet_init();
+#endif
+
+	// type-c协议栈用注入通道的vbus电压，启动前开始采样
+	vbus_monitor_start();
+	// pd协商耗时最长，最先启动，控制环路紧接着启动
 	pd_start(&app);
+	boot_mark(BOOT_STAGE_PD);
 	temp_adc_init();
+	boot_mark(BOOT_STAGE_ADC);
 
 	if (init_tip_controller(&app)) {
 		LOG_ERR("Soldering tip controller init failed");
 		return -1;
 	}
-	if(sleep_detection_init(&app)){
-		LOG_ERR("Sleep detection init failed");
-		return -1;
-    }
+	pd_attach_heater((uint32_t)(app.tip_ctrl->heater_r_ohm * 1000));
+	boot_mark(BOOT_STAGE_CONTROL);
 
-	while (1) {
-		app_draw(&app);
+	// 加速度计只注册周期任务，第一次读取和清屏后的刷新一样在服务执行器中进行
+	if (sleep_detection_init(&app)) {
+		LOG_ERR("Sleep detection init failed");
 	}
+	boot_mark(BOOT_STAGE_ACCEL);
+	app_display_init(&app);
+	boot_mark(BOOT_STAGE_DISPLAY);
+#if defined(CONFIG_CLOCK_SCALING)
+	clock_profile_init(&app);
+#endif
+	boot_report_init();
+
+	// main线程作为服务执行器，运行所有后台周期任务
+	service_run();
 	return 0;
 }
@@ -36,6 +36,15 @@ void moving_avg_init(moving_avg_filter_ctx *ctx, uint32_t window_length)
     ctx->window_pointer = 0;
     ctx->sum = 0;
 
+    /* Power-of-two windows divide with a shift */
+    ctx->shift = -1;
+    if (window_length > 0 && (window_length & (window_length - 1)) == 0) {
+        ctx->shift = 0;
+        while ((1u << ctx->shift) < window_length) {
+            ctx->shift++;
+        }
+    }
+
     for (uint32_t i = 0; i < ctx->window_length; i++) {
         ctx->history[i] = 0;
     }
@@ -51,7 +60,10 @@ uint32_t moving_avg_compute(moving_avg_filter_ctx *ctx, uint32_t raw_data)
     } else {
         ctx->window_pointer = 0;
     }
-    return ctx->sum /ctx->window_length;
+    if (ctx->shift >= 0) {
+        return ctx->sum >> ctx->shift;
+    }
+    return ctx->sum / ctx->window_length;
 }
 
 void moving_avg_set_value(moving_avg_filter_ctx *ctx, uint32_t raw_data)
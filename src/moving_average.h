@@ -41,6 +41,7 @@ typedef struct {
     uint32_t window_pointer; /* Pointer to the first element of window */
     uint32_t history[MAX_WINDOW_LENGTH]; /* Array to store values of filter window */
     uint32_t sum; /* Sum of filter window's elements */
+    int8_t shift; /* log2(window_length) if it is a power of two, otherwise -1 */
 } moving_avg_filter_ctx;
 
 
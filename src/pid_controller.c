@@ -1,7 +1,7 @@
 
-
 #include "pid_controller.h"
 #include <math.h>
+#include <string.h>
 
 // 初始化 PID
 void pid_init(pid_controller *pid, float kp, float ki, float kd, uint32_t sample_time,
@@ -11,28 +11,45 @@ void pid_init(pid_controller *pid, float kp, float ki, float kd, uint32_t sample
 	pid->output = 0;
 	pid->sample_time = sample_time;
 
+	// 初始化积分项和上次输入
+	pid->output_sum = 0;
+	pid->last_input = 0;
+	pid->d_term = 0;
+	pid->last_error_p = 0;
+	pid->last_error_d = 0;
+	pid->last_setpoint = 0;
+	pid->unsat_output = 0;
+
+	// 默认等同于普通pid：微分作用在测量值上，不滤波，不反算
+	pid->sp_weight_p = 1.0f;
+	pid->sp_weight_d = 0;
+	pid->d_filter_n = 0;
+	pid->kt = 0;
+
 	pid_set_output_limits(pid, 0, 100);
 
 	// 设置控制方向和调谐参数
+	pid->kp = pid->ki = pid->kd = 0;
+	pid->controller_direction = PID_CD_DIRECT;
 	pid_set_controller_direction(pid, controller_direction);
 	pid_set_tunings(pid, kp, ki, kd);
-
-	// 初始化积分项和上次输入
-	pid->output_sum = 0;
-	pid->last_input = 0;
 }
 
 // 计算 PID 输出
 float pid_compute(pid_controller *pid, float input, float setpoint)
 {
-
 	float error = setpoint - input;
-	float d_input = (input - pid->last_input);
+	float error_p = pid->sp_weight_p * setpoint - input;
+	float error_d = pid->sp_weight_d * setpoint - input;
+
+	// 设定值变化时修正微分历史，避免微分冲击
+	if (setpoint != pid->last_setpoint) {
+		pid->last_error_d += pid->sp_weight_d * (setpoint - pid->last_setpoint);
+		pid->last_setpoint = setpoint;
+	}
 
 	// 积分项
-	// if(fabsf(error)>5.0f){
 	pid->output_sum += (pid->ki * error);
-	//}
 
 	// 限幅积分项
 	if (pid->output_sum > pid->out_max) {
@@ -41,10 +58,19 @@ float pid_compute(pid_controller *pid, float input, float setpoint)
 		pid->output_sum = pid->out_min;
 	}
 
-	// 计算输出
-	float output = pid->kp * error;
+	// 一阶低通滤波的微分项，时间常数Tf=Td/N
+	float d_raw = pid->kd * (error_d - pid->last_error_d);
+	float alpha = 0;
+	if (pid->d_filter_n > 0 && pid->kp != 0) {
+		float dt = (float)pid->sample_time / 1000.0f;
+		float tf = fabsf(pid->kd / pid->kp) * dt / pid->d_filter_n;
+		alpha = tf / (tf + dt);
+	}
+	pid->d_term = alpha * pid->d_term + (1.0f - alpha) * d_raw;
 
-	output += pid->output_sum - pid->kd * d_input;
+	// 计算输出
+	float output = pid->kp * error_p + pid->output_sum + pid->d_term;
+	pid->unsat_output = output;
 
 	// 限幅输出
 	if (output > pid->out_max) {
@@ -57,9 +83,46 @@ float pid_compute(pid_controller *pid, float input, float setpoint)
 
 	// 保存状态
 	pid->last_input = input;
+	pid->last_error_p = error_p;
+	pid->last_error_d = error_d;
 	return output;
 }
 
+void pid_track(pid_controller *pid, float applied_output)
+{
+	// 执行器饱和时把积分项往实际输出拉回，防止积分饱和
+	pid->output_sum += pid->kt * (applied_output - pid->unsat_output);
+	pid->unsat_output = applied_output;
+}
+
+void pid_reset(pid_controller *pid, float input, float setpoint, float output)
+{
+	pid->last_input = input;
+	pid->last_setpoint = setpoint;
+	pid->last_error_p = pid->sp_weight_p * setpoint - input;
+	pid->last_error_d = pid->sp_weight_d * setpoint - input;
+	pid->d_term = 0;
+	// 积分项补足比例项，保证切换时输出不跳变
+	pid->output_sum = output - pid->kp * pid->last_error_p;
+	if (pid->output_sum > pid->out_max) {
+		pid->output_sum = pid->out_max;
+	} else if (pid->output_sum < pid->out_min) {
+		pid->output_sum = pid->out_min;
+	}
+	pid->output = output;
+	pid->unsat_output = output;
+}
+
+void pid_set_integral(pid_controller *pid, float output_sum)
+{
+	if (output_sum > pid->out_max) {
+		output_sum = pid->out_max;
+	} else if (output_sum < pid->out_min) {
+		output_sum = pid->out_min;
+	}
+	pid->output_sum = output_sum;
+}
+
 // 设置输出限制
 void pid_set_output_limits(pid_controller *pid, float min, float max)
 {
@@ -94,6 +157,9 @@ void pid_set_tunings(pid_controller *pid, float kp, float ki, float kd)
 	pid->disp_ki = ki;
 	pid->disp_kd = kd;
 
+	float old_kp = pid->kp;
+	float old_kd = pid->kd;
+
 	float sample_time_in_sec = (float)pid->sample_time / 1000.0f;
 	pid->kp = kp;
 	pid->ki = ki * sample_time_in_sec;
@@ -104,7 +170,40 @@ void pid_set_tunings(pid_controller *pid, float kp, float ki, float kd)
 		pid->ki = -pid->ki;
 		pid->kd = -pid->kd;
 	}
+
+	// 无扰切换：比例项的变化由积分项吸收，微分项按比例缩放
+	pid->output_sum += (old_kp - pid->kp) * pid->last_error_p;
+	pid->d_term = old_kd != 0 ? pid->d_term * (pid->kd / old_kd) : 0;
+}
+
+void pid_set_setpoint_weights(pid_controller *pid, float weight_p, float weight_d)
+{
+	if (weight_p < 0 || weight_p > 1 || weight_d < 0 || weight_d > 1) {
+		return;
+	}
+	// 保持当前输出不变
+	float error_p = pid->last_error_p + (weight_p - pid->sp_weight_p) * pid->last_setpoint;
+	pid->output_sum += pid->kp * (pid->last_error_p - error_p);
+	pid->last_error_p = error_p;
+	pid->last_error_d += (weight_d - pid->sp_weight_d) * pid->last_setpoint;
+	pid->sp_weight_p = weight_p;
+	pid->sp_weight_d = weight_d;
+}
+
+void pid_set_derivative_filter(pid_controller *pid, float n)
+{
+	if (n >= 0) {
+		pid->d_filter_n = n;
+	}
 }
+
+void pid_set_tracking_gain(pid_controller *pid, float kt)
+{
+	if (kt >= 0 && kt <= 1) {
+		pid->kt = kt;
+	}
+}
+
 // 设置采样时间
 void pid_set_sample_time(pid_controller *pid, uint32_t new_sample_time)
 {
@@ -148,3 +247,87 @@ float pid_get_output(const pid_controller *pid)
 {
 	return pid->output;
 }
+
+// 升温/保温增益切换时每次采样的过渡步长
+#define PID_SCHED_BLEND_STEP 0.05f
+
+void pid_schedule_init(pid_gain_schedule *sched, const pid_gain_point *hold,
+		       const pid_gain_point *heat, uint8_t count, float heat_band)
+{
+	if (count > PID_SCHED_MAX_POINTS) {
+		count = PID_SCHED_MAX_POINTS;
+	}
+	memcpy(sched->hold, hold, count * sizeof(pid_gain_point));
+	memcpy(sched->heat, heat, count * sizeof(pid_gain_point));
+	sched->count = count;
+	sched->heat_band = heat_band;
+	sched->blend = 0;
+}
+
+static void schedule_interpolate(const pid_gain_point *table, uint8_t count, float temp,
+				 pid_gain_point *out)
+{
+	if (temp <= table[0].temp || count == 1) {
+		*out = table[0];
+		return;
+	}
+	for (uint8_t i = 1; i < count; i++) {
+		if (temp < table[i].temp) {
+			const pid_gain_point *a = &table[i - 1];
+			const pid_gain_point *b = &table[i];
+			float t = (temp - a->temp) / (b->temp - a->temp);
+			out->kp = a->kp + t * (b->kp - a->kp);
+			out->ki = a->ki + t * (b->ki - a->ki);
+			out->kd = a->kd + t * (b->kd - a->kd);
+			return;
+		}
+	}
+	*out = table[count - 1];
+}
+
+void pid_schedule_update(pid_controller *pid, pid_gain_schedule *sched, float setpoint,
+			 float error)
+{
+	pid_gain_point hold, heat;
+
+	if (sched->count == 0) {
+		return;
+	}
+
+	// 带回差，误差降到一半才回到保温增益
+	float target = sched->blend;
+	if (error > sched->heat_band) {
+		target = 1.0f;
+	} else if (error < sched->heat_band / 2) {
+		target = 0;
+	}
+	if (target > sched->blend) {
+		sched->blend = fminf(sched->blend + PID_SCHED_BLEND_STEP, target);
+	} else if (target < sched->blend) {
+		sched->blend = fmaxf(sched->blend - PID_SCHED_BLEND_STEP, target);
+	}
+
+	schedule_interpolate(sched->hold, sched->count, setpoint, &hold);
+	schedule_interpolate(sched->heat, sched->count, setpoint, &heat);
+
+	float b = sched->blend;
+	float kp = hold.kp + b * (heat.kp - hold.kp);
+	float ki = hold.ki + b * (heat.ki - hold.ki);
+	float kd = hold.kd + b * (heat.kd - hold.kd);
+
+	if (kp != pid->disp_kp || ki != pid->disp_ki || kd != pid->disp_kd) {
+		pid_set_tunings(pid, kp, ki, kd);
+	}
+}
+
+uint8_t pid_schedule_nearest(const pid_gain_schedule *sched, float setpoint)
+{
+	uint8_t idx = 0;
+
+	for (uint8_t i = 1; i < sched->count; i++) {
+		if (fabsf(sched->hold[i].temp - setpoint) < fabsf(sched->hold[idx].temp - setpoint)) {
+			idx = i;
+		}
+	}
+	return idx;
+}
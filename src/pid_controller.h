@@ -16,12 +16,40 @@ typedef struct pid_controller {
   uint32_t sample_time;            // 采样时间（毫秒）
   float out_min, out_max;          // 输出限制
   uint8_t controller_direction;    // 控制方向
+  // 二自由度：比例、微分项的设定值权重
+  float sp_weight_p, sp_weight_d;
+  float d_filter_n;                // 微分滤波系数N，时间常数Td/N，0不滤波
+  float d_term;                    // 滤波后的微分项
+  float last_error_p, last_error_d;// 上一次加权误差
+  float last_setpoint;
+  float unsat_output;              // 限幅前的输出，用于反算抗饱和
+  float kt;                        // 反算抗饱和增益（每次采样）
 } pid_controller;
 
 void pid_init(pid_controller *pid, float kp, float ki, float kd,
               uint32_t sample_time, uint8_t controller_direction);
 
 float pid_compute(pid_controller *pid, float input, float setpoint);
+
+/**
+ * @brief 反算抗饱和，告诉pid实际作用到执行器上的输出
+ * 在下一次pid_compute前调用，包括pid之后的所有限幅（例如最大占空比）
+ */
+void pid_track(pid_controller *pid, float applied_output);
+
+/**
+ * @brief 无扰切换，从当前输入和输出重新开始控制
+ */
+void pid_reset(pid_controller *pid, float input, float setpoint, float output);
+
+/**
+ * @brief 直接设置积分项，用于前馈预置
+ */
+void pid_set_integral(pid_controller *pid, float output_sum);
+
+void pid_set_setpoint_weights(pid_controller *pid, float weight_p, float weight_d);
+void pid_set_derivative_filter(pid_controller *pid, float n);
+void pid_set_tracking_gain(pid_controller *pid, float kt);
 void pid_set_output_limits(pid_controller *pid, float min, float max);
 
 void pid_set_sample_time(pid_controller *pid, uint32_t new_sample_time);
@@ -34,4 +62,37 @@ uint8_t pid_get_direction(const pid_controller *pid);
 
 float pid_get_output(const pid_controller *pid);
 
+/*
+ * 增益调度：按设定温度在增益表中线性插值，
+ * 升温（误差大）和保温使用不同的增益表，两者之间平滑过渡
+ */
+#define PID_SCHED_MAX_POINTS 4
+
+typedef struct pid_gain_point {
+  float temp;                      // 设定温度（℃）
+  float kp, ki, kd;
+} pid_gain_point;
+
+typedef struct pid_gain_schedule {
+  pid_gain_point hold[PID_SCHED_MAX_POINTS]; // 保温增益，按温度升序
+  pid_gain_point heat[PID_SCHED_MAX_POINTS]; // 升温增益，温度点与保温相同
+  uint8_t count;
+  float heat_band;                 // 误差超过该值使用升温增益
+  float blend;                     // 0保温, 1升温
+} pid_gain_schedule;
+
+void pid_schedule_init(pid_gain_schedule *sched, const pid_gain_point *hold,
+                       const pid_gain_point *heat, uint8_t count, float heat_band);
+
+/**
+ * @brief 根据设定温度和误差更新pid增益，增益变化通过pid_set_tunings无扰切换
+ */
+void pid_schedule_update(pid_controller *pid, pid_gain_schedule *sched, float setpoint,
+                         float error);
+
+/**
+ * @brief 返回离设定温度最近的增益点下标
+ */
+uint8_t pid_schedule_nearest(const pid_gain_schedule *sched, float setpoint);
+
 #endif //__PID_CONTROLLER_H
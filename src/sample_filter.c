@@ -0,0 +1,106 @@
+
+#include <errno.h>
+#include <string.h>
+
+#include "moving_average.h"
+#include "sample_filter.h"
+
+void filter_chain_init(filter_chain *chain)
+{
+	chain->count = 0;
+}
+
+int filter_chain_add(filter_chain *chain, filter_compute_t compute, void *ctx)
+{
+	if (chain->count >= MAX_FILTER_STAGES) {
+		return -ENOMEM;
+	}
+	chain->stages[chain->count].compute = compute;
+	chain->stages[chain->count].ctx = ctx;
+	chain->count++;
+	return 0;
+}
+
+uint32_t filter_chain_compute(filter_chain *chain, uint32_t raw_data)
+{
+	for (uint8_t i = 0; i < chain->count; i++) {
+		raw_data = chain->stages[i].compute(chain->stages[i].ctx, raw_data);
+	}
+	return raw_data;
+}
+
+void hampel_init(hampel_filter_ctx *ctx, uint32_t window_length, uint32_t k_10x,
+		 uint32_t min_dev)
+{
+	if (window_length > MAX_HAMPEL_WINDOW) {
+		window_length = MAX_HAMPEL_WINDOW;
+	}
+	ctx->window_length = window_length;
+	ctx->window_pointer = 0;
+	ctx->filled = 0;
+	ctx->k_10x = k_10x;
+	ctx->min_dev = min_dev;
+	memset(ctx->history, 0, sizeof(ctx->history));
+}
+
+// 窗口很小，插入排序即可
+static uint32_t median(uint32_t *buf, uint32_t n)
+{
+	for (uint32_t i = 1; i < n; i++) {
+		uint32_t v = buf[i];
+		uint32_t j = i;
+		while (j > 0 && buf[j - 1] > v) {
+			buf[j] = buf[j - 1];
+			j--;
+		}
+		buf[j] = v;
+	}
+	return buf[n / 2];
+}
+
+uint32_t hampel_compute(hampel_filter_ctx *ctx, uint32_t raw_data)
+{
+	uint32_t buf[MAX_HAMPEL_WINDOW];
+	uint32_t n;
+
+	// 新值也放入窗口，真实的阶跃在半个窗口后就能通过
+	ctx->history[ctx->window_pointer] = raw_data;
+	ctx->window_pointer = (ctx->window_pointer + 1) % ctx->window_length;
+	if (ctx->filled < ctx->window_length) {
+		ctx->filled++;
+	}
+	n = ctx->filled;
+	if (n < 3) {
+		return raw_data;
+	}
+
+	memcpy(buf, ctx->history, n * sizeof(buf[0]));
+	uint32_t med = median(buf, n);
+
+	for (uint32_t i = 0; i < n; i++) {
+		buf[i] = ctx->history[i] > med ? ctx->history[i] - med : med - ctx->history[i];
+	}
+	uint32_t mad = median(buf, n);
+
+	// 1.4826 * k * MAD，k放大了10倍
+	uint32_t threshold = (mad * ctx->k_10x * 1483) / 10000;
+	if (threshold < ctx->min_dev) {
+		threshold = ctx->min_dev;
+	}
+
+	uint32_t dev = raw_data > med ? raw_data - med : med - raw_data;
+	if (dev > threshold) {
+		return med;
+	}
+	return raw_data;
+}
+
+uint32_t filter_stage_hampel(void *ctx, uint32_t raw_data)
+{
+	return hampel_compute(ctx, raw_data);
+}
+
+uint32_t filter_stage_moving_avg(void *ctx, uint32_t raw_data)
+{
+	return moving_avg_compute(ctx, raw_data);
+}
@@ -0,0 +1,52 @@
+#ifndef __SAMPLE_FILTER_H
+#define __SAMPLE_FILTER_H
+
+#include <stdint.h>
+
+#define MAX_FILTER_STAGES  4
+#define MAX_HAMPEL_WINDOW  9
+
+/*
+ * 可组合的采样滤波链，每一级输入输出都是adc原始值
+ */
+typedef uint32_t (*filter_compute_t)(void *ctx, uint32_t raw_data);
+
+typedef struct {
+    filter_compute_t compute;
+    void *ctx;
+} filter_stage;
+
+typedef struct {
+    filter_stage stages[MAX_FILTER_STAGES];
+    uint8_t count;
+} filter_chain;
+
+/*
+ * Hampel滤波，去除尖峰
+ * 新值与窗口中值的偏差超过 max(k * 1.4826 * MAD, min_dev) 时用中值替代
+ */
+typedef struct {
+    uint32_t window_length;
+    uint32_t window_pointer;
+    uint32_t filled;
+    uint32_t history[MAX_HAMPEL_WINDOW];
+    uint32_t k_10x;   /* 阈值系数k，放大10倍 */
+    uint32_t min_dev; /* 最小偏差阈值，避免MAD为0时误判 */
+} hampel_filter_ctx;
+
+void filter_chain_init(filter_chain *chain);
+
+int filter_chain_add(filter_chain *chain, filter_compute_t compute, void *ctx);
+
+uint32_t filter_chain_compute(filter_chain *chain, uint32_t raw_data);
+
+void hampel_init(hampel_filter_ctx *ctx, uint32_t window_length, uint32_t k_10x,
+                 uint32_t min_dev);
+
+uint32_t hampel_compute(hampel_filter_ctx *ctx, uint32_t raw_data);
+
+/* 用于滤波链的包装 */
+uint32_t filter_stage_hampel(void *ctx, uint32_t raw_data);
+uint32_t filter_stage_moving_avg(void *ctx, uint32_t raw_data);
+
+#endif // __SAMPLE_FILTER_H
@@ -0,0 +1,144 @@
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "service.h"
+
+LOG_MODULE_REGISTER(service, LOG_LEVEL_INF);
+
+// 统计信息输出周期
+#define SERVICE_STATS_PERIOD_MS (60 * 1000)
+
+static LIST_HEAD(service_list, service_job) jobs = LIST_HEAD_INITIALIZER(jobs);
+// 只在头部插入，统计时不加锁遍历
+static SLIST_HEAD(service_all, service_job) all_jobs = SLIST_HEAD_INITIALIZER(all_jobs);
+static struct k_spinlock lock;
+// 有任务加入或需要马上执行时唤醒执行器
+static K_SEM_DEFINE(wake_sem, 0, 1);
+
+static inline bool time_before(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) < 0;
+}
+
+// 按到期时间插入，调用时已持有锁
+static void insert_locked(struct service_job *job)
+{
+	struct service_job *it, *prev = NULL;
+
+	if (!job->registered) {
+		SLIST_INSERT_HEAD(&all_jobs, job, all);
+		job->registered = true;
+	}
+	if (job->queued) {
+		LIST_REMOVE(job, entry);
+	}
+	LIST_FOREACH(it, &jobs, entry) {
+		if (time_before(job->due_ms, it->due_ms)) {
+			break;
+		}
+		prev = it;
+	}
+	if (prev == NULL) {
+		LIST_INSERT_HEAD(&jobs, job, entry);
+	} else {
+		LIST_INSERT_AFTER(prev, job, entry);
+	}
+	job->queued = true;
+}
+
+void service_add(struct service_job *job, uint32_t delay_ms, uint32_t period_ms)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	job->period_ms = period_ms;
+	job->due_ms = k_uptime_get_32() + delay_ms;
+	insert_locked(job);
+	k_spin_unlock(&lock, key);
+	k_sem_give(&wake_sem);
+}
+
+void service_set_period(struct service_job *job, uint32_t period_ms)
+{
+	job->period_ms = period_ms;
+}
+
+void service_kick(struct service_job *job)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	job->due_ms = k_uptime_get_32();
+	insert_locked(job);
+	k_spin_unlock(&lock, key);
+	k_sem_give(&wake_sem);
+}
+
+void service_remove(struct service_job *job)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	if (job->queued) {
+		LIST_REMOVE(job, entry);
+		job->queued = false;
+	}
+	k_spin_unlock(&lock, key);
+}
+
+void service_log_stats(void)
+{
+	struct service_job *it;
+
+	SLIST_FOREACH(it, &all_jobs, all) {
+		LOG_INF("%-12s period %5u ms runs %6u max %6u us late %4u ms", it->name,
+			it->period_ms, it->runs, it->max_run_us, it->max_late_ms);
+	}
+}
+
+static void stats_handler(struct service_job *job)
+{
+	ARG_UNUSED(job);
+	service_log_stats();
+}
+
+static struct service_job stats_job = SERVICE_JOB_INITIALIZER("stats", stats_handler);
+
+void service_run(void)
+{
+	service_add(&stats_job, SERVICE_STATS_PERIOD_MS, SERVICE_STATS_PERIOD_MS);
+
+	while (1) {
+		k_spinlock_key_t key = k_spin_lock(&lock);
+		struct service_job *job = LIST_FIRST(&jobs);
+		uint32_t now = k_uptime_get_32();
+
+		if (job == NULL || time_before(now, job->due_ms)) {
+			// 没有到期任务，休眠到下一个到期时间或被唤醒
+			k_timeout_t timeout = job == NULL ? K_FOREVER : K_MSEC(job->due_ms - now);
+			k_spin_unlock(&lock, key);
+			k_sem_take(&wake_sem, timeout);
+			continue;
+		}
+		LIST_REMOVE(job, entry);
+		job->queued = false;
+		k_spin_unlock(&lock, key);
+
+		job->max_late_ms = MAX(job->max_late_ms, now - job->due_ms);
+		uint32_t start = k_cycle_get_32();
+		job->handler(job);
+		uint32_t run_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+		job->runs++;
+		job->max_run_us = MAX(job->max_run_us, run_us);
+
+		// 周期任务按固定节拍重新排队，处理函数里可能已经重新加入
+		key = k_spin_lock(&lock);
+		if (!job->queued && job->period_ms > 0) {
+			job->due_ms += job->period_ms;
+			if (time_before(job->due_ms, now)) {
+				// 落后太多时不追赶
+				job->due_ms = now + job->period_ms;
+			}
+			insert_locked(job);
+		}
+		k_spin_unlock(&lock, key);
+	}
+}
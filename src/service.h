@@ -0,0 +1,61 @@
+#ifndef __SERVICE_H
+#define __SERVICE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "queque.h"
+
+/*
+ * 后台服务执行器：所有周期性的后台任务（加速度计、ina226、冷端温度、界面刷新）
+ * 在main线程里按到期时间顺序执行，代替各自的线程和栈。
+ * 控制环路对时间要求高，仍然使用自己的工作队列。
+ */
+struct service_job {
+  LIST_ENTRY(service_job) entry; // 按到期时间排序的链表
+  SLIST_ENTRY(service_job) all;  // 所有加入过的任务，用于统计
+  void (*handler)(struct service_job *job);
+  const char *name;
+  uint32_t due_ms;
+  uint32_t period_ms;            // 0表示只执行一次
+  bool queued;
+  bool registered;
+  // 统计
+  uint32_t runs;
+  uint32_t max_run_us;
+  uint32_t max_late_ms;          // 相对到期时间的最大延迟
+};
+
+#define SERVICE_JOB_INITIALIZER(_name, _handler)                                                  \
+	{                                                                                          \
+		.handler = (_handler), .name = (_name),                                            \
+	}
+
+/**
+ * @brief 添加任务，delay_ms后第一次执行，之后每period_ms执行一次
+ */
+void service_add(struct service_job *job, uint32_t delay_ms, uint32_t period_ms);
+
+/**
+ * @brief 修改周期，下次执行后生效
+ */
+void service_set_period(struct service_job *job, uint32_t period_ms);
+
+/**
+ * @brief 尽快执行任务，可以在其他线程和中断里调用
+ */
+void service_kick(struct service_job *job);
+
+void service_remove(struct service_job *job);
+
+/**
+ * @brief 输出各任务的执行次数和耗时
+ */
+void service_log_stats(void);
+
+/**
+ * @brief 执行器主循环，不返回
+ */
+void service_run(void);
+
+#endif // __SERVICE_H
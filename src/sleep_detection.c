@@ -4,9 +4,13 @@
 #include <zephyr/drivers/sensor.h>
 #include <zephyr/pm/device.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
 #include <math.h>
 #include "sleep_detection.h"
 #include "app_ui.h"
+#include "service.h"
+#include "deep_sleep.h"
+#include "i2c_bus.h"
 
 // 日志模块
 LOG_MODULE_REGISTER(sleep_detection, LOG_LEVEL_INF);
@@ -16,75 +20,116 @@ LOG_MODULE_REGISTER(sleep_detection, LOG_LEVEL_INF);
 #define SLEEP_TIMEOUT   5000           // 休眠超时（ms）
 #define STOP_TIMEOUT    1000 * 10 * 60 // 暂停超时（ms）,这里10分钟一直sleep模式就进入stop模式
 #define SAMPLE_INTERVAL 200            // 采样间隔（ms）
+#define SLEEP_SAMPLE_INTERVAL 50       // 休眠时加快采样，拿起后尽早唤醒加热
 
 static const struct device *lis2dw_dev = DEVICE_DT_GET(DT_NODELABEL(lis2dw));
 
-// 姿态检测线程函数
-static void posture_detection_thread(void *arg1, void *arg2, void *arg3)
-{
-	struct app *app = (struct app *)arg1;
-	struct sensor_value accel[3]; // X, Y, Z加速度
+static struct app *detect_app;
 
-	static uint32_t sleep_timer_start = 0;
+/*
+ * 加速度通过i2c总线调度读取，优先级低于ina226功率读取。
+ * 周期任务只提交读取，读取完成后再执行姿态判断
+ */
+#define LIS2DW12_REG_OUT_X_L 0x28
+// 输出左对齐16位，满量程对应32768
+#define LIS2DW12_RANGE_G     DT_PROP(DT_NODELABEL(lis2dw), range)
 
-	if (!device_is_ready(lis2dw_dev)) {
-		LOG_ERR("LIS2DW12 device not ready");
+I2C_DT_IODEV_DEFINE(lis2dw_iodev, DT_NODELABEL(lis2dw));
+
+static uint8_t accel_reg = LIS2DW12_REG_OUT_X_L;
+// 寄存器地址自动递增，一次读出xyz
+static uint8_t accel_buf[6];
+static struct i2c_msg accel_msgs[] = {
+	{.buf = &accel_reg, .len = 1, .flags = I2C_MSG_WRITE},
+	{.buf = accel_buf, .len = sizeof(accel_buf),
+	 .flags = I2C_MSG_RESTART | I2C_MSG_READ | I2C_MSG_STOP},
+};
+static float accel[3]; // X, Y, Z加速度（m/s²）
+
+static struct service_job posture_job;
+
+static void accel_done(struct i2c_bus_req *req, int result)
+{
+	if (result < 0) {
+		LOG_ERR("Failed to fetch sensor data");
 		return;
 	}
+	for (int i = 0; i < 3; i++) {
+		accel[i] = (int16_t)sys_get_le16(&accel_buf[i * 2]) * LIS2DW12_RANGE_G *
+			   SENSOR_G / 1000000.0f / 32768;
+	}
+	service_kick(&posture_job);
+}
 
-	while (1) {
-		// 读取加速度
-		if (sensor_sample_fetch_chan(lis2dw_dev, SENSOR_CHAN_ACCEL_XYZ) < 0) {
-			LOG_ERR("Failed to fetch sensor data");
-            goto failed;
-		}
+static struct i2c_bus_req accel_req = {
+	.iodev = &lis2dw_iodev,
+	.msgs = accel_msgs,
+	.num_msgs = ARRAY_SIZE(accel_msgs),
+	.prio = I2C_BUS_PRIO_LOW,
+	.done = accel_done,
+};
 
-		if (sensor_channel_get(lis2dw_dev, SENSOR_CHAN_ACCEL_XYZ, accel) < 0) {
-			LOG_ERR("Failed to get acceleration data");
-            goto failed;
-		}
+static void accel_poll_handler(struct service_job *job)
+{
+	i2c_bus_submit(&accel_req);
+	service_set_period(job, detect_app->tip_ctrl->is_sleeping ? SLEEP_SAMPLE_INTERVAL
+								  : SAMPLE_INTERVAL);
+}
+
+static struct service_job accel_poll_job = SERVICE_JOB_INITIALIZER("accel", accel_poll_handler);
 
-		float ax = sensor_value_to_float(&accel[0]);
-		float ay = sensor_value_to_float(&accel[1]);
-		float az = sensor_value_to_float(&accel[2]);
+// 姿态检测，读取到加速度后在服务执行器中执行
+static void posture_detection_handler(struct service_job *job)
+{
+	struct app *app = detect_app;
 
-		// 计算总加速度
-		float a_total = sqrtf(ax * ax + ay * ay + az * az);
+	static uint32_t sleep_timer_start = 0;
 
-		app->test = (int32_t)(ay * 100);
+	float ax = accel[0];
+	float ay = accel[1];
+	float az = accel[2];
 
-		// 判断姿态
-		if (ay < AY_MIN &&
-		    fabsf(a_total - 9.81f) < 1.0f) { // 非向下倾斜且微小移动则可能进入休眠计时
-			// 非工作姿态或晃动
-			if (sleep_timer_start == 0) {
-				sleep_timer_start = k_uptime_get_32();
-			}
+	// 计算总加速度
+	float a_total = sqrtf(ax * ax + ay * ay + az * az);
 
-			// 检查休眠超时
-			uint32_t time_diff = k_uptime_get_32() - sleep_timer_start;
+	app->test = (int32_t)(ay * 100);
 
-			// 先判断更长时间的停止状态，然后判断休眠
-			if (sleep_timer_start > 0 && time_diff >= STOP_TIMEOUT) {
-				app->tip_ctrl->is_sleeping = true;
-				app_event_handler(app, EVT_ENTER_PREVIEW); // 进入预览界面会关闭加热
-			} else if (sleep_timer_start > 0 && time_diff >= SLEEP_TIMEOUT) {
-				app->tip_ctrl->is_sleeping = true;
+	// 判断姿态
+	if (ay < AY_MIN &&
+	    fabsf(a_total - 9.81f) < 1.0f) { // 非向下倾斜且微小移动则可能进入休眠计时
+		// 非工作姿态或晃动
+		if (sleep_timer_start == 0) {
+			sleep_timer_start = k_uptime_get_32();
+		}
+
+		// 检查休眠超时
+		uint32_t time_diff = k_uptime_get_32() - sleep_timer_start;
+
+		// 先判断更长时间的停止状态，然后判断休眠
+		if (sleep_timer_start > 0 && time_diff >= STOP_TIMEOUT) {
+			app->tip_ctrl->is_sleeping = true;
+			app_event_handler(app, EVT_ENTER_PREVIEW); // 进入预览界面会关闭加热
+#if defined(CONFIG_DEEP_SLEEP)
+			// 等到拿起或按键才返回，重新开始计时；
+			// 无法唤醒时留在预览界面，加热已经关闭
+			if (deep_sleep_enter() < 0) {
+				LOG_WRN("Deep sleep unavailable");
 			}
-		} else {
 			sleep_timer_start = 0;
-			if (app->tip_ctrl->is_sleeping) {
-				app->tip_ctrl->is_sleeping = false;
-			}
+#endif
+		} else if (sleep_timer_start > 0 && time_diff >= SLEEP_TIMEOUT) {
+			app->tip_ctrl->is_sleeping = true;
+		}
+	} else {
+		sleep_timer_start = 0;
+		if (app->tip_ctrl->is_sleeping) {
+			tip_wake_up();
 		}
-failed:
-		k_msleep(SAMPLE_INTERVAL);
 	}
 }
 
-// 线程栈和ID
-K_THREAD_STACK_DEFINE(posture_thread_stack, 512);
-static struct k_thread posture_thread_data;
+static struct service_job posture_job =
+	SERVICE_JOB_INITIALIZER("posture", posture_detection_handler);
 
 // 初始化并启动休眠检测
 int sleep_detection_init(struct app *app)
@@ -93,13 +138,12 @@ int sleep_detection_init(struct app *app)
 		LOG_ERR("LIS2DW device not ready");
 		return -EINVAL;
 	}
-	// 启动线程
-	k_thread_create(&posture_thread_data, posture_thread_stack,
-			K_THREAD_STACK_SIZEOF(posture_thread_stack), posture_detection_thread,
-			(void *)app, NULL, NULL, 100, 0, K_NO_WAIT);
-
-	k_thread_name_set(&posture_thread_data, "sleep_detection");
+	detect_app = app;
+#if defined(CONFIG_DEEP_SLEEP)
+	deep_sleep_init(app);
+#endif
+	service_add(&accel_poll_job, 0, SAMPLE_INTERVAL);
 
-	LOG_INF("Sleep detection thread started");
+	LOG_INF("Sleep detection started");
 	return 0;
 }
@@ -0,0 +1,95 @@
+
+#include "smith_predictor.h"
+
+// 温升超过该值认为测量已经响应
+#define IDENT_RISE_C   3.0f
+// 超过该时间没有响应放弃辨识
+#define IDENT_TIMEOUT_MS 2000
+
+void smith_init(smith_predictor *sp, float heat_gain, float loss_coef, uint16_t dead_ms,
+		uint16_t max_dead_ms)
+{
+	sp->heat_gain = heat_gain;
+	sp->loss_coef = loss_coef;
+	sp->max_dead_ms = max_dead_ms;
+	sp->dead_ms = dead_ms < max_dead_ms ? dead_ms : max_dead_ms;
+	sp->ident_active = false;
+	smith_reset(sp, 0);
+}
+
+void smith_reset(smith_predictor *sp, float rise)
+{
+	sp->y = rise;
+	sp->head = 0;
+	sp->count = 0;
+}
+
+// 返回dead_ms之前的模型温升，历史不够时用最早的记录
+static float smith_delayed(const smith_predictor *sp)
+{
+	uint32_t t = 0;
+	uint8_t idx = sp->head;
+	float y = sp->y;
+
+	for (uint8_t i = 0; i < sp->count && t < sp->dead_ms; i++) {
+		idx = idx == 0 ? SMITH_MAX_HISTORY - 1 : idx - 1;
+		y = sp->hist[idx];
+		t += sp->hist_dt[idx];
+	}
+	return y;
+}
+
+float smith_update(smith_predictor *sp, float power_w, uint16_t dt_ms)
+{
+	if (sp->dead_ms == 0) {
+		return 0;
+	}
+	// 保存更新前的模型温升，对应dt_ms之前的时刻
+	sp->hist[sp->head] = sp->y;
+	sp->hist_dt[sp->head] = dt_ms;
+	sp->head = (sp->head + 1) % SMITH_MAX_HISTORY;
+	if (sp->count < SMITH_MAX_HISTORY) {
+		sp->count++;
+	}
+
+	float dt = dt_ms / 1000.0f;
+	sp->y += (sp->heat_gain * power_w - sp->loss_coef * sp->y) * dt;
+
+	return sp->y - smith_delayed(sp);
+}
+
+void smith_identify_start(smith_predictor *sp, float temp)
+{
+	sp->ident_active = true;
+	sp->ident_temp0 = temp;
+	sp->ident_rise = 0;
+	sp->ident_ms = 0;
+	sp->ident_model_ms = 0;
+}
+
+void smith_identify_update(smith_predictor *sp, float temp, float power_w, uint16_t dt_ms)
+{
+	if (!sp->ident_active) {
+		return;
+	}
+	sp->ident_ms += dt_ms;
+	if (sp->ident_ms > IDENT_TIMEOUT_MS) {
+		sp->ident_active = false;
+		return;
+	}
+	// 冷态开始加热，忽略散热
+	sp->ident_rise += sp->heat_gain * power_w * dt_ms / 1000.0f;
+	if (sp->ident_model_ms == 0 && sp->ident_rise >= IDENT_RISE_C) {
+		sp->ident_model_ms = sp->ident_ms;
+	}
+	if (temp - sp->ident_temp0 < IDENT_RISE_C) {
+		return;
+	}
+	sp->ident_active = false;
+	if (sp->ident_model_ms == 0 || sp->ident_ms < sp->ident_model_ms) {
+		return;
+	}
+	// 和之前的值平均，减小单次测量的误差
+	uint32_t dead = (sp->dead_ms + (sp->ident_ms - sp->ident_model_ms)) / 2;
+	sp->dead_ms = dead < sp->max_dead_ms ? dead : sp->max_dead_ms;
+}
@@ -0,0 +1,59 @@
+#ifndef __SMITH_PREDICTOR_H
+#define __SMITH_PREDICTOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// 延时历史长度，最短采样周期下需要覆盖整个死区时间
+#define SMITH_MAX_HISTORY 32
+
+/*
+ * Smith预估器补偿热电偶测量延时
+ * 模型: dy/dt = heat_gain * P - loss_coef * y，y为相对环境温度的温升
+ * pid输入 = 测量温度 + (y(t) - y(t - dead_time))
+ */
+typedef struct smith_predictor {
+  float heat_gain;               // 加热功率对升温速率的增益（℃/J）
+  float loss_coef;               // 散热系数（1/s）
+  uint16_t dead_ms;              // 死区时间
+  uint16_t max_dead_ms;
+  float y;                       // 无延时模型温升
+  float hist[SMITH_MAX_HISTORY]; // 模型温升历史
+  uint16_t hist_dt[SMITH_MAX_HISTORY];
+  uint8_t head;
+  uint8_t count;
+  // 冷启动加热时辨识死区时间
+  bool ident_active;
+  float ident_temp0;
+  float ident_rise;              // 模型预测的累计温升
+  uint32_t ident_ms;
+  uint32_t ident_model_ms;       // 模型温升达到阈值的时间
+} smith_predictor;
+
+void smith_init(smith_predictor *sp, float heat_gain, float loss_coef, uint16_t dead_ms,
+		uint16_t max_dead_ms);
+
+/**
+ * @brief 清空历史，模型温升从当前温升开始
+ */
+void smith_reset(smith_predictor *sp, float rise);
+
+/**
+ * @brief 更新模型并返回延时补偿量
+ * @param power_w 上一采样周期内的平均加热功率（W）
+ * @param dt_ms 采样周期（ms）
+ * @retval 加到测量温度上的补偿量（℃）
+ */
+float smith_update(smith_predictor *sp, float power_w, uint16_t dt_ms);
+
+/**
+ * @brief 开始从冷态加热时调用，辨识死区时间
+ */
+void smith_identify_start(smith_predictor *sp, float temp);
+
+/**
+ * @brief 比较测量温升和模型温升，得到死区时间
+ */
+void smith_identify_update(smith_predictor *sp, float temp, float power_w, uint16_t dt_ms);
+
+#endif // __SMITH_PREDICTOR_H
@@ -0,0 +1,67 @@
+
+#include "temp_estimator.h"
+
+void temp_kf_init(temp_kf *kf, float heat_gain, float loss_coef, float q_t, float q_d, float r)
+{
+	kf->heat_gain = heat_gain;
+	kf->loss_coef = loss_coef;
+	kf->q_t = q_t;
+	kf->q_d = q_d;
+	kf->r = r;
+	kf->inited = false;
+	temp_kf_reset(kf, 0);
+}
+
+void temp_kf_reset(temp_kf *kf, float temp)
+{
+	kf->t = temp;
+	kf->d = 0;
+	kf->rate = 0;
+	// 初始温度按测量噪声，偏差不确定
+	kf->p[0][0] = kf->r;
+	kf->p[0][1] = 0;
+	kf->p[1][0] = 0;
+	kf->p[1][1] = kf->q_d;
+}
+
+float temp_kf_update(temp_kf *kf, float meas, float power_w, float ambient, float dt)
+{
+	if (!kf->inited) {
+		temp_kf_reset(kf, meas);
+		kf->inited = true;
+		return kf->t;
+	}
+
+	// 预测
+	float f00 = 1.0f - kf->loss_coef * dt;
+	float rate = kf->heat_gain * power_w - kf->loss_coef * (kf->t - ambient) + kf->d;
+	kf->t += rate * dt;
+
+	// P = F P F' + Q, F = [f00 dt; 0 1]
+	float p00 = kf->p[0][0], p01 = kf->p[0][1], p10 = kf->p[1][0], p11 = kf->p[1][1];
+	float fp00 = f00 * p00 + dt * p10;
+	float fp01 = f00 * p01 + dt * p11;
+	kf->p[0][0] = fp00 * f00 + fp01 * dt + kf->q_t * dt;
+	kf->p[0][1] = fp01;
+	kf->p[1][0] = p10 * f00 + p11 * dt;
+	kf->p[1][1] = p11 + kf->q_d * dt;
+
+	// 修正, H = [1 0]
+	float s = kf->p[0][0] + kf->r;
+	float k0 = kf->p[0][0] / s;
+	float k1 = kf->p[1][0] / s;
+	float y = meas - kf->t;
+
+	kf->t += k0 * y;
+	kf->d += k1 * y;
+
+	p00 = kf->p[0][0];
+	p01 = kf->p[0][1];
+	kf->p[0][0] = (1.0f - k0) * p00;
+	kf->p[0][1] = (1.0f - k0) * p01;
+	kf->p[1][0] -= k1 * p00;
+	kf->p[1][1] -= k1 * p01;
+
+	kf->rate = kf->heat_gain * power_w - kf->loss_coef * (kf->t - ambient) + kf->d;
+	return kf->t;
+}
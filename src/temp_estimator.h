@@ -0,0 +1,37 @@
+#ifndef __TEMP_ESTIMATOR_H
+#define __TEMP_ESTIMATOR_H
+
+#include <stdbool.h>
+
+/*
+ * 二状态卡尔曼滤波估计烙铁头温度
+ * 状态: 温度t, 模型未描述的升温速率偏差d
+ * 模型: dt/dt = heat_gain * P - loss_coef * (t - ambient) + d
+ */
+typedef struct temp_kf {
+  float t;             // 估计温度（℃）
+  float d;             // 速率偏差（℃/s）
+  float rate;          // 估计升温速率（℃/s）
+  float p[2][2];       // 协方差
+  float heat_gain;     // 加热功率对升温速率的增益（℃/J）
+  float loss_coef;     // 散热系数（1/s）
+  float q_t, q_d;      // 过程噪声（每秒）
+  float r;             // 测量噪声
+  bool inited;
+} temp_kf;
+
+void temp_kf_init(temp_kf *kf, float heat_gain, float loss_coef, float q_t, float q_d, float r);
+
+void temp_kf_reset(temp_kf *kf, float temp);
+
+/**
+ * @brief 用上一周期的加热功率预测，再用测量温度修正
+ * @param meas 测量温度（℃）
+ * @param power_w 上一采样周期内的平均加热功率（W）
+ * @param ambient 环境温度（℃）
+ * @param dt 采样周期（s）
+ * @retval 估计温度
+ */
+float temp_kf_update(temp_kf *kf, float meas, float power_w, float ambient, float dt);
+
+#endif // __TEMP_ESTIMATOR_H
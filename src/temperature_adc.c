@@ -7,6 +7,7 @@
 #include <zephyr/device.h>
 
 #include "temperature_adc.h"
+#include "vbus_monitor.h"
 
 LOG_MODULE_REGISTER(tip_temp_adc, LOG_LEVEL_INF);
 
@@ -25,7 +26,7 @@ static const struct adc_dt_spec adc_chan0 = ADC_DT_SPEC_GET_BY_IDX(DT_PATH(zephy
 
 
 static const struct device *die_sensor = DEVICE_DT_GET(DT_NODELABEL(die_temp));
-static double cool_temp;
+static float cool_temp; // float保证转换只用硬件单精度浮点
 
 // 初始化 ADC
 int temp_adc_init()
@@ -53,14 +54,22 @@ int temp_adc_init()
 
 void update_cool_temp()
 {
-	cool_temp = read_die_temp();
+	cool_temp = (float)read_die_temp();
+}
+
+float get_cool_temp(void)
+{
+	return cool_temp;
 }
 
 double read_die_temp()
 {
 	int ret;
 	struct sensor_value temp;
+	// 芯片温度和vbus共用adc1，zephyr的adc驱动转换结束后会关闭adc
+	vbus_monitor_pause();
 	ret = sensor_sample_fetch_chan(die_sensor, SENSOR_CHAN_DIE_TEMP);
+	vbus_monitor_resume();
 	if (ret < 0) {
 		return 25;
 	}
@@ -114,6 +123,11 @@ int temp_read_adc_raw(uint32_t *raw)
 	return 0;
 }
 
+uint32_t temp_adc_raw_max(void)
+{
+	return ADC_RES_LEVELS - 1;
+}
+
 #if defined(CONFIG_BOARD_T12_G431)
 
 // From https://github.com/Ralim/IronOS/blob/dev/source/Core/BSP/Miniware/ThermoModel.cpp
@@ -207,24 +221,26 @@ float temp_raw_to_temperature(uint32_t raw)
 // From https://github.com/AxxAxx/AxxSolder
 //
 
-#define TC_COMPENSATION_X2_T245 (-6.818562488097707e-07)
-#define TC_COMPENSATION_X1_T245 0.1432374243560926
-#define TC_COMPENSATION_X0_T245 23.777399955382318
+#define TC_COMPENSATION_X2_T245 (-6.818562488097707e-07f)
+#define TC_COMPENSATION_X1_T245 0.1432374243560926f
+#define TC_COMPENSATION_X0_T245 23.777399955382318f
 
 float temp_raw_to_temperature(uint32_t raw)
 {
-	return raw * raw * TC_COMPENSATION_X2_T245 + raw * TC_COMPENSATION_X1_T245 + cool_temp;
+	float x = raw;
+	return x * x * TC_COMPENSATION_X2_T245 + x * TC_COMPENSATION_X1_T245 + cool_temp;
 }
 #else
 
 // From https://github.com/AxxAxx/AxxSolder
 //
-#define TC_COMPENSATION_X2_T210 (6.082461666584128e-06)
-#define TC_COMPENSATION_X1_T210 0.3823655573322506
+#define TC_COMPENSATION_X2_T210 (6.082461666584128e-06f)
+#define TC_COMPENSATION_X1_T210 0.3823655573322506f
 // #define TC_COMPENSATION_X0_T210 20.968033870812942
 
 float temp_raw_to_temperature(uint32_t raw)
 {
-	return raw * raw * TC_COMPENSATION_X2_T210 + raw * TC_COMPENSATION_X1_T210 + cool_temp;
+	float x = raw;
+	return x * x * TC_COMPENSATION_X2_T210 + x * TC_COMPENSATION_X1_T210 + cool_temp;
 }
 #endif
@@ -16,6 +16,9 @@ void update_cool_temp();
 
 double read_die_temp();
 
+// 冷端（环境）温度
+float get_cool_temp(void);
+
 /**
  * @brief 从 ADC 读取电压值
  *
@@ -27,6 +30,9 @@ int temp_read_adc_voltage(uint32_t *voltage_mv);
 
 int temp_read_adc_raw(uint32_t *raw);
 
+// adc原始值的满量程
+uint32_t temp_adc_raw_max(void);
+
 float temp_raw_to_temperature(uint32_t raw);
 
 #endif /* __TEMPERATURE_ADC_H */
@@ -9,12 +9,28 @@
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/display.h>
 
+#include "adc_quiet.h"
+
 #define RGB565_SIZE 2
 
 #define fill_color(_buf, _idx, _color)                                                             \
 	(_buf)[_idx] = (_color) >> 8;                                                              \
 	(_buf)[_idx + 1] = (_color) & 0xFFu;
 
+// 烙铁头采样时不开始spi传输，避免干扰热电偶信号
+static int canvas_write(const struct device *dev, uint16_t x, uint16_t y,
+			const struct display_buffer_descriptor *desc, const void *buf)
+{
+#if defined(CONFIG_DISPLAY_ADC_QUIET)
+	adc_quiet_xfer_begin(desc->buf_size);
+	int ret = display_write(dev, x, y, desc, buf);
+	adc_quiet_xfer_end();
+	return ret;
+#else
+	return display_write(dev, x, y, desc, buf);
+#endif
+}
+
 void draw_fill_rect(const struct device *dev, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
 		    uint16_t color)
 {
@@ -42,7 +58,7 @@ void draw_fill_rect(const struct device *dev, uint16_t x, uint16_t y, uint16_t w
 		if (hy + h_step > h) {
 			desc.height = h - hy;
 		}
-		display_write(dev, x, y + hy, &desc, buf);
+		canvas_write(dev, x, y + hy, &desc, buf);
 	}
 	k_free(buf);
 }
@@ -54,20 +70,86 @@ void draw_fill_screen(const struct device *dev, uint16_t color)
 	draw_fill_rect(dev, 0, 0, caps.x_resolution, caps.y_resolution, color);
 }
 
-static void fill_char(char ch, FontDef font, uint16_t fore, uint16_t back, uint8_t *buf)
+void draw_pixels(const struct device *dev, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+		 const uint16_t *pixels)
 {
-	uint32_t b;
+	struct display_buffer_descriptor desc;
+	desc.buf_size = w * h * RGB565_SIZE;
+	desc.pitch = w;
+	desc.width = w;
+	desc.height = h;
 
-	uint16_t idx = 0;
-	for (uint32_t i = 0; i < font.height; i++) {
-		b = font.data[(ch - 32) * font.height + i];
-		for (uint32_t j = 0; j < font.width; j++) {
-			if ((b << j) & 0x8000) {
-				fill_color(buf, idx, fore);
-			} else {
+	uint8_t *buf = k_malloc(desc.buf_size);
+	if (buf == NULL) {
+		return;
+	}
+	for (uint16_t i = 0, idx = 0; i < w * h; i++) {
+		fill_color(buf, idx, pixels[i]);
+		idx += 2;
+	}
+	canvas_write(dev, x, y, &desc, buf);
+	k_free(buf);
+}
+
+// 查找字符在字体子集中的位置，没有时返回-1
+static int find_glyph(const FontDef *font, uint8_t ch)
+{
+	int lo = 0;
+	int hi = font->count - 1;
+
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+
+		if (font->chars[mid] == ch) {
+			return mid;
+		} else if (font->chars[mid] < ch) {
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return -1;
+}
+
+// 直接把字符点阵解码成rgb565写入行缓冲
+static void fill_char(char ch, const FontDef *font, uint16_t fore, uint16_t back, uint8_t *buf)
+{
+	uint32_t pixels = font->width * font->height;
+	int glyph = find_glyph(font, (uint8_t)ch);
+	uint32_t idx = 0;
+
+	if (glyph < 0) {
+		for (uint32_t i = 0; i < pixels; i++, idx += 2) {
+			fill_color(buf, idx, back);
+		}
+		return;
+	}
+
+	if (font->offsets != NULL) {
+		const uint8_t *p = &font->data[font->offsets[glyph]];
+
+		for (uint32_t i = 0; i < pixels; p++) {
+			uint32_t bg = MIN(*p >> 4, pixels - i);
+			uint32_t fg = MIN(*p & 0x0F, pixels - i - bg);
+
+			for (uint32_t n = 0; n < bg; n++, idx += 2) {
 				fill_color(buf, idx, back);
 			}
-			idx += 2;
+			for (uint32_t n = 0; n < fg; n++, idx += 2) {
+				fill_color(buf, idx, fore);
+			}
+			i += bg + fg;
+		}
+		return;
+	}
+
+	const uint8_t *bits = &font->data[glyph * DIV_ROUND_UP(pixels, 8)];
+
+	for (uint32_t i = 0; i < pixels; i++, idx += 2) {
+		if (bits[i / 8] & (0x80 >> (i % 8))) {
+			fill_color(buf, idx, fore);
+		} else {
+			fill_color(buf, idx, back);
 		}
 	}
 }
@@ -92,8 +174,8 @@ uint16_t draw_text(const struct device *dev, const char *str, uint16_t x, uint16
 
 	uint16_t count = 0;
 	for (uint16_t startx = x; *str; str++, startx += font.width, count++) {
-		fill_char(*str, font, fore, back, buf);
-		display_write(dev, startx, y, &desc, buf);
+		fill_char(*str, &font, fore, back, (uint8_t *)buf);
+		canvas_write(dev, startx, y, &desc, buf);
 	}
 	k_free(buf);
 	return count;
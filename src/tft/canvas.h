@@ -25,6 +25,10 @@ void draw_fill_rect(const struct device *dev, uint16_t x, uint16_t y, uint16_t w
 		    uint16_t color);
 void draw_fill_screen(const struct device *dev, uint16_t color);
 
+// 按行写入w*h个rgb565像素
+void draw_pixels(const struct device *dev, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+		 const uint16_t *pixels);
+
 uint16_t draw_text(const struct device *dev, const char *str, uint16_t x, uint16_t y, FontDef font,
 	       uint16_t fore, uint16_t back);
 #endif //__CANVAS_H_
@@ -4,19 +4,20 @@
 
 #include <stdint.h>
 
+/*
+ * 编译时由scripts/gen_fonts.py从fonts_ascii.inc生成，只包含界面用到的字符（见CMakeLists.txt）
+ * 每个字符按1bpp逐行连续存放，大字体可能用半字节rle压缩：
+ * 每个字节高4位是背景长度，低4位是前景长度
+ */
 typedef struct {
     const uint8_t width;
     const uint8_t height;
-    const uint16_t *data;
+    const uint8_t count;        // 字符数
+    const uint8_t *chars;       // 包含的字符，升序
+    const uint8_t *data;
+    const uint16_t *offsets;    // rle压缩时每个字符在data中的起始位置，不压缩时为NULL
 } FontDef;
 
-
-extern FontDef Font_7x10;
-extern FontDef Font_11x18;
-extern FontDef Font_16x26;
-
-extern FontDef Font_8x15;
-
-extern FontDef Font_13x21;
+#include "fonts_gen.h"
 
 #endif // __FONTS_H__
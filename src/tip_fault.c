@@ -0,0 +1,132 @@
+#include <math.h>
+
+#include "tip_fault.h"
+
+// 占空比用Q16小数表示
+#define DUTY_ONE (1u << 16)
+
+// 距满量程不到1/256认为饱和
+#define SAT_MARGIN_SHIFT 8
+// 相邻两次采样的温度噪声余量（℃）
+#define SLEW_MARGIN_C    10.0f
+// 占空比对应功率太小时ina226的读数主要是电路本身的功耗，不检查
+#define POWER_CHECK_MIN_W 5.0f
+// 实际功率低于期望的1/4认为发热芯开路，高于3倍认为短路
+#define POWER_LOW_DIV    4
+#define POWER_HIGH_MUL   3
+// 连续几次ina226读数不符才确认，避免占空比突变时的误判
+#define POWER_CONFIRM    3
+
+void tip_fault_init(struct tip_fault *f, uint32_t raw_max)
+{
+	*f = (struct tip_fault){0};
+	f->sat_raw = raw_max - (raw_max >> SAT_MARGIN_SHIFT);
+}
+
+uint8_t tip_fault_check_raw(struct tip_fault *f, int adc_ret, uint32_t raw, bool heating)
+{
+	uint8_t suspect = 0;
+
+	if (adc_ret != 0) {
+		f->last_valid = false;
+		return TIP_FAULT_ADC;
+	}
+	if (raw >= f->sat_raw) {
+		suspect |= TIP_FAULT_SATURATED;
+	}
+	// 停止加热后不计数也不清零，读数一直不变时故障保持
+	if (raw != f->last_raw) {
+		f->last_raw = raw;
+		f->same_count = 0;
+	} else if (heating && f->same_count < UINT16_MAX) {
+		f->same_count++;
+	}
+	if (f->same_count >= CONFIG_TIP_FAULT_STUCK_SAMPLES) {
+		suspect |= TIP_FAULT_STUCK;
+	}
+	if (suspect & TIP_FAULT_REMOVED) {
+		f->heater_latched = false;
+	}
+	if (suspect != 0) {
+		f->last_valid = false;
+	}
+	return suspect;
+}
+
+uint8_t tip_fault_check_temp(struct tip_fault *f, float temp, uint16_t elapsed_ms)
+{
+	if (temp > CONFIG_TIP_FAULT_MAX_TEMP_C) {
+		f->heater_latched = false;
+		f->last_valid = false;
+		return TIP_FAULT_OPEN;
+	}
+	bool valid = f->last_valid;
+	float last = f->last_temp;
+
+	f->last_temp = temp;
+	f->last_valid = true;
+	if (valid) {
+		float max_step = CONFIG_TIP_FAULT_MAX_SLEW_C_PER_S * elapsed_ms / 1000.0f + SLEW_MARGIN_C;
+
+		if (fabsf(temp - last) > max_step) {
+			// 下一次采样重新开始比较
+			f->last_valid = false;
+			return TIP_FAULT_SLEW;
+		}
+	}
+	return 0;
+}
+
+uint8_t tip_fault_check_power(struct tip_fault *f, uint32_t duty_q16, uint32_t ina_seq,
+			      uint16_t vbus_mv, uint32_t power_mw, float heater_r_ohm)
+{
+	f->duty_acc += duty_q16;
+	f->duty_n++;
+	if (ina_seq != f->ina_seq) {
+		float duty = (float)f->duty_acc / f->duty_n / DUTY_ONE;
+		float v = vbus_mv / 1000.0f;
+		float expect = duty * v * v / heater_r_ohm;
+		float p = power_mw / 1000.0f;
+
+		f->ina_seq = ina_seq;
+		f->duty_acc = 0;
+		f->duty_n = 0;
+		if (expect >= POWER_CHECK_MIN_W) {
+			if (p < expect / POWER_LOW_DIV || p > expect * POWER_HIGH_MUL) {
+				f->power_count++;
+			} else {
+				f->power_count = 0;
+			}
+			if (f->power_count >= POWER_CONFIRM) {
+				f->power_count = 0;
+				f->heater_latched = true;
+			}
+		}
+	}
+	return f->heater_latched ? TIP_FAULT_HEATER : 0;
+}
+
+bool tip_fault_update(struct tip_fault *f, uint8_t suspect)
+{
+	uint8_t prev = f->active;
+
+	if (suspect != 0) {
+		f->clear_count = 0;
+		if (f->confirm_count < CONFIG_TIP_FAULT_CONFIRM_SAMPLES) {
+			f->confirm_count++;
+		}
+		if (f->confirm_count >= CONFIG_TIP_FAULT_CONFIRM_SAMPLES) {
+			f->active |= suspect;
+		}
+	} else {
+		f->confirm_count = 0;
+		if (f->active != 0 && ++f->clear_count >= CONFIG_TIP_FAULT_CLEAR_SAMPLES) {
+			f->active = 0;
+			f->clear_count = 0;
+		}
+	}
+	if (prev == 0 && f->active != 0) {
+		f->faults++;
+	}
+	return f->active != prev;
+}
@@ -0,0 +1,81 @@
+#ifndef __TIP_FAULT_H
+#define __TIP_FAULT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * 烙铁头故障检测，在控制环路每次采样时执行：
+ * 原始值检查adc读取失败、饱和、长时间不变，转换后的温度检查热电偶开路和不可能的变化速率，
+ * 有新的ina226读数时比较实际功率和占空比对应的功率，检查发热芯开路或短路。
+ * 任意一项可疑时调用方在本次采样关断加热，连续可疑才确认故障并通知界面；
+ * 拔下烙铁头表现为开路或饱和，插回后连续几次正常就清除故障，马上重新加热。
+ */
+
+// 故障类型（位）
+#define TIP_FAULT_ADC       (1u << 0) // adc读取失败
+#define TIP_FAULT_SATURATED (1u << 1) // 放大器输出饱和，一般是没有插烙铁头
+#define TIP_FAULT_STUCK     (1u << 2) // 加热时读数长时间不变
+#define TIP_FAULT_OPEN      (1u << 3) // 温度超出范围，热电偶开路
+#define TIP_FAULT_HEATER    (1u << 4) // 功率和占空比不符，发热芯开路或短路
+#define TIP_FAULT_SLEW      (1u << 5) // 温度变化速率超出物理可能
+
+// 拔下烙铁头时出现的故障
+#define TIP_FAULT_REMOVED   (TIP_FAULT_SATURATED | TIP_FAULT_OPEN)
+// 原始值的故障，这时不能再滤波和转换温度
+#define TIP_FAULT_RAW       (TIP_FAULT_ADC | TIP_FAULT_SATURATED | TIP_FAULT_STUCK)
+
+struct tip_fault {
+  uint8_t active;         // 已确认的故障
+  uint8_t confirm_count;  // 连续可疑的采样次数
+  uint8_t clear_count;    // 确认故障后连续正常的采样次数
+  bool heater_latched;    // 发热芯故障，停止加热后无法再检查，拔下烙铁头才清除
+  uint32_t sat_raw;       // 不小于该值认为饱和
+  uint32_t last_raw;
+  uint16_t same_count;    // 加热时原始值连续不变的次数
+  float last_temp;
+  bool last_valid;        // last_temp是否为正常采样的温度，为假时调用方重新开始滤波
+  // 两次ina226读数之间的平均占空比
+  uint64_t duty_acc;
+  uint32_t duty_n;
+  uint32_t ina_seq;
+  uint8_t power_count;    // 连续功率不符的读数次数
+  uint32_t faults;        // 确认故障的次数
+};
+
+/**
+ * @brief 初始化
+ * @param raw_max adc原始值的满量程
+ */
+void tip_fault_init(struct tip_fault *f, uint32_t raw_max);
+
+/**
+ * @brief 检查adc原始值
+ * @param adc_ret adc读取的返回值
+ * @param heating 上一采样周期是否在加热
+ * @retval 本次采样可疑的故障
+ */
+uint8_t tip_fault_check_raw(struct tip_fault *f, int adc_ret, uint32_t raw, bool heating);
+
+/**
+ * @brief 检查滤波后转换得到的温度
+ * @param elapsed_ms 距离上次采样的时间
+ */
+uint8_t tip_fault_check_temp(struct tip_fault *f, float temp, uint16_t elapsed_ms);
+
+/**
+ * @brief 每次采样累计占空比，ina_seq变化时比较测得的功率和占空比对应的功率
+ * @param duty_q16 上一采样周期的占空比
+ * @param ina_seq ina226读数的序号，每次读取完成加1
+ */
+uint8_t tip_fault_check_power(struct tip_fault *f, uint32_t duty_q16, uint32_t ina_seq,
+			      uint16_t vbus_mv, uint32_t power_mw, float heater_r_ohm);
+
+/**
+ * @brief 汇总本次采样的检查结果
+ * @param suspect 本次采样可疑的故障
+ * @retval 确认的故障是否变化（出现或清除）
+ */
+bool tip_fault_update(struct tip_fault *f, uint8_t suspect);
+
+#endif // __TIP_FAULT_H
@@ -0,0 +1,81 @@
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/logging/log.h>
+
+#include "tip_settings.h"
+
+LOG_MODULE_REGISTER(tip_settings, LOG_LEVEL_INF);
+
+#define TIP_SETTINGS_ROOT "tip"
+
+static struct tip_settings settings;
+
+static int tip_settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+	const char *next;
+	int ret;
+
+	if (settings_name_steq(name, "settle_us", &next) && !next) {
+		if (len != sizeof(settings.settle_us)) {
+			return -EINVAL;
+		}
+		ret = read_cb(cb_arg, &settings.settle_us, sizeof(settings.settle_us));
+		return ret < 0 ? ret : 0;
+	}
+	if (settings_name_steq(name, "gains", &next) && !next) {
+		// 结构体变化后旧数据直接忽略
+		if (len != sizeof(settings.gains)) {
+			return -EINVAL;
+		}
+		ret = read_cb(cb_arg, &settings.gains, sizeof(settings.gains));
+		if (ret < 0) {
+			return ret;
+		}
+		settings.gains_valid = settings.gains.count > 0 &&
+				       settings.gains.count <= PID_SCHED_MAX_POINTS;
+		return 0;
+	}
+	return -ENOENT;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(tip, TIP_SETTINGS_ROOT, NULL, tip_settings_set, NULL, NULL);
+
+int tip_settings_init(void)
+{
+	int ret;
+
+	memset(&settings, 0, sizeof(settings));
+
+	ret = settings_subsys_init();
+	if (ret != 0) {
+		LOG_ERR("Settings init failed: %d", ret);
+		return ret;
+	}
+	ret = settings_load_subtree(TIP_SETTINGS_ROOT);
+	if (ret != 0) {
+		LOG_ERR("Settings load failed: %d", ret);
+	}
+	return ret;
+}
+
+const struct tip_settings *tip_settings_get(void)
+{
+	return &settings;
+}
+
+int tip_settings_save_settle_us(uint16_t settle_us)
+{
+	settings.settle_us = settle_us;
+	return settings_save_one(TIP_SETTINGS_ROOT "/settle_us", &settings.settle_us,
+				 sizeof(settings.settle_us));
+}
+
+int tip_settings_save_gains(const pid_gain_schedule *gains)
+{
+	settings.gains = *gains;
+	settings.gains_valid = true;
+	return settings_save_one(TIP_SETTINGS_ROOT "/gains", &settings.gains,
+				 sizeof(settings.gains));
+}
@@ -0,0 +1,24 @@
+#ifndef __TIP_SETTINGS_H
+#define __TIP_SETTINGS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pid_controller.h"
+
+// 保存在flash storage分区中的烙铁头参数，0表示未保存过
+struct tip_settings {
+  uint16_t settle_us; // 实测的mosfet/热电偶放大器稳定时间
+  bool gains_valid;   // 是否保存过增益表
+  pid_gain_schedule gains;
+};
+
+int tip_settings_init(void);
+
+const struct tip_settings *tip_settings_get(void);
+
+int tip_settings_save_settle_us(uint16_t settle_us);
+
+int tip_settings_save_gains(const pid_gain_schedule *gains);
+
+#endif // __TIP_SETTINGS_H
@@ -0,0 +1,52 @@
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+#include "heater_controller.h"
+#include "trend.h"
+
+BUILD_ASSERT(IS_POWER_OF_TWO(TREND_HISTORY), "trend history must be a power of two");
+
+static struct trend_point points[TREND_HISTORY];
+// 控制环路写入，界面刷新读取，先写点再增加序号
+static atomic_t seq;
+
+// 当前降采样周期的累计值，按采样周期加权
+static float temp_sum;
+static float setpoint_sum;
+static uint64_t duty_sum;
+static uint32_t sum_ms;
+
+void trend_record(float temp, float setpoint, uint32_t duty_q16, uint16_t elapsed_ms)
+{
+	temp_sum += temp * elapsed_ms;
+	setpoint_sum += setpoint * elapsed_ms;
+	duty_sum += (uint64_t)duty_q16 * elapsed_ms;
+	sum_ms += elapsed_ms;
+	if (sum_ms < CONFIG_UI_TREND_PERIOD_MS) {
+		return;
+	}
+
+	uint32_t n = (uint32_t)atomic_get(&seq);
+	struct trend_point *pt = &points[n % TREND_HISTORY];
+
+	pt->temp_x10 = (int16_t)(temp_sum * 10 / sum_ms);
+	pt->setpoint = (int16_t)(setpoint_sum / sum_ms);
+	pt->power = (uint8_t)MIN(duty_sum * 255 / sum_ms / MAX_DUTY_Q16, 255);
+	atomic_set(&seq, (atomic_val_t)(n + 1));
+
+	temp_sum = 0;
+	setpoint_sum = 0;
+	duty_sum = 0;
+	sum_ms = 0;
+}
+
+uint32_t trend_seq(void)
+{
+	return (uint32_t)atomic_get(&seq);
+}
+
+struct trend_point trend_get(uint32_t n)
+{
+	return points[n % TREND_HISTORY];
+}
@@ -0,0 +1,31 @@
+#ifndef __TREND_H
+#define __TREND_H
+
+#include <stdint.h>
+
+// 历史长度，需要大于趋势图宽度
+#define TREND_HISTORY 64
+
+// 一个降采样周期内的平均值
+struct trend_point {
+  int16_t temp_x10;    // 温度（0.1℃）
+  int16_t setpoint;    // 当时的目标温度（℃），含休眠和预热温度
+  uint8_t power;       // 平均占空比，255为最大占空比
+};
+
+/**
+ * @brief 在控制环路中每次采样后调用，累计到CONFIG_UI_TREND_PERIOD_MS后写入一个点
+ */
+void trend_record(float temp, float setpoint, uint32_t duty_q16, uint16_t elapsed_ms);
+
+/**
+ * @brief 已写入的点数，只增不减
+ */
+uint32_t trend_seq(void);
+
+/**
+ * @brief 读取第seq个点，只能读取最近TREND_HISTORY个点
+ */
+struct trend_point trend_get(uint32_t seq);
+
+#endif // __TREND_H
@@ -5,6 +5,7 @@
 #include "app_ui.h"
 #include "usb_pd.h"
 #include "zephyr/usb_c/usbc.h"
+#include <string.h>
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(usbc, LOG_LEVEL_DBG);
 
@@ -23,8 +24,8 @@ static struct port0_data_t port0_data = {
 
 /**
  * @brief Builds a Request Data Object (RDO) with the following properties:
- *		- Maximum operating current 100mA
- *		- Operating current is 100mA
+ *		- Operating and maximum operating current is the heater current
+ *		  at the selected PDO, capped by the PDO current (100mA without caps)
  *		- Unchunked Extended Messages Not Supported
  *		- No USB Suspend
  *		- Not USB Communications Capable
@@ -45,8 +46,11 @@ static uint32_t build_rdo(struct port0_data_t *dpm_data)
 	src_pdo.raw_value = dpm_data->src_caps[req_idx];
 
 	if (dpm_data->src_cap_cnt > 0 && src_pdo.type == PDO_FIXED) {
-		rdo.fixed.min_or_max_operating_current = src_pdo.max_current;
-		rdo.fixed.operating_current = src_pdo.max_current;
+		// 10mA单位向上取整，不超过档位最大电流
+		uint32_t current = DIV_ROUND_UP(dpm_data->req_current_ma, 10);
+		current = MIN(current, src_pdo.max_current);
+		rdo.fixed.min_or_max_operating_current = current;
+		rdo.fixed.operating_current = current;
 	} else {
 		/* Maximum operating current 100mA (GIVEBACK = 0) */
 		rdo.fixed.min_or_max_operating_current = PD_CONVERT_MA_TO_FIXED_PDO_CURRENT(100);
@@ -82,33 +86,57 @@ static int port0_policy_cb_get_snk_cap(const struct device *dev, uint32_t **pdos
 	return 0;
 }
 
+/*
+ * 按发热芯电阻给已收到的档位排序，返回功率最大的档位，功率相同时保留低电压档位。
+ * 发热芯能得到的功率 P = min(V^2/R, V*Imax)
+ */
+static uint8_t pdo_select(const struct port0_data_t *dpm_data, uint16_t *current_ma,
+			  uint32_t *power_mw)
+{
+	uint8_t idx = 0;
+
+	*current_ma = 100;
+	*power_mw = 0;
+	for (int i = 0; i < dpm_data->src_cap_cnt; i++) {
+		union pd_fixed_supply_pdo_source src_pdo = {.raw_value = dpm_data->src_caps[i]};
+
+		uint16_t vol = PD_CONVERT_FIXED_PDO_VOLTAGE_TO_MV(src_pdo.voltage);
+		if (src_pdo.type != PDO_FIXED || vol == 0 || vol > CONFIG_PD_MAX_REQUESTED_VOLTAGE) {
+			continue;
+		}
+		uint32_t max_ma = PD_CONVERT_FIXED_PDO_CURRENT_TO_MA(src_pdo.max_current);
+		uint32_t load_ma = max_ma;
+		if (dpm_data->heater_mohm > 0) {
+			load_ma = MIN((uint32_t)vol * 1000 / dpm_data->heater_mohm, max_ma);
+		}
+		uint32_t mw = (uint32_t)vol * load_ma / 1000;
+		if (mw > *power_mw) {
+			*power_mw = mw;
+			*current_ma = load_ma;
+			idx = i;
+		}
+	}
+	return idx;
+}
+
 static void port0_policy_cb_set_src_cap(const struct device *dev, const uint32_t *pdos,
 					const int num_pdos)
 {
 	struct port0_data_t *dpm_data;
 	int num;
+	uint32_t best_mw;
 
 	dpm_data = usbc_get_dpm_data(dev);
-	dpm_data->req_idx = 0;
 
 	num = num_pdos;
 	if (num > PDO_MAX_DATA_OBJECTS) {
 		num = PDO_MAX_DATA_OBJECTS;
 	}
-
-	for (int i = 0; i < num; i++) {
-		dpm_data->src_caps[i] = *(pdos + i);
-		union pd_fixed_supply_pdo_source src_pdo = {.raw_value = *(pdos + i)};
-
-		uint16_t vol = PD_CONVERT_FIXED_PDO_VOLTAGE_TO_MV(src_pdo.voltage);
-		if (src_pdo.type == PDO_FIXED &&
-		    (vol > 0 &&
-		     vol <= CONFIG_PD_MAX_REQUESTED_VOLTAGE)) { // 从低到高尽可能匹配目标电压
-			dpm_data->req_idx = i;
-		}
-	}
-
+	memcpy(dpm_data->src_caps, pdos, num * sizeof(uint32_t));
 	dpm_data->src_cap_cnt = num;
+
+	dpm_data->req_idx = pdo_select(dpm_data, &dpm_data->req_current_ma, &best_mw);
+	LOG_INF("Request PDO %d, %u mW", dpm_data->req_idx + 1, best_mw);
 }
 
 static uint32_t port0_policy_cb_get_rdo(const struct device *dev)
@@ -119,6 +147,25 @@ static uint32_t port0_policy_cb_get_rdo(const struct device *dev)
 }
 /* usbc.rst callbacks end */
 
+// ps_ready的第1位：加热控制器已启动，可以接收电源限制
+#define HEATER_READY_BIT 1
+
+// type-c默认电流按usb2.0的500mA
+#define TYPEC_DEFAULT_CURRENT_MA 500
+
+// 没有pd合约时按type-c广播的电流限制加热
+static void typec_power_change(struct port0_data_t *dpm_data, uint16_t ma)
+{
+	dpm_data->typec_current_ma = ma;
+	if (atomic_test_bit(&dpm_data->ps_ready, 0) ||
+	    !atomic_test_bit(&dpm_data->ps_ready, HEATER_READY_BIT)) {
+		return;
+	}
+#if defined(CONFIG_TIP_PREHEAT)
+	tip_preheat_update(ma);
+#endif
+}
+
 /* usbc.rst notify start */
 static void port0_notify(const struct device *dev, const enum usbc_policy_notify_t policy_notify)
 {
@@ -129,14 +176,23 @@ static void port0_notify(const struct device *dev, const enum usbc_policy_notify
 		break;
 	case MSG_DISCARDED:
 		break;
-	case MSG_ACCEPT_RECEIVED:
-		break;
 	case MSG_REJECTED_RECEIVED:
 		break;
 	case MSG_NOT_SUPPORTED_RECEIVED:
 		break;
+	case MSG_ACCEPT_RECEIVED:
+		// 电源切换期间按待机功率，先关闭加热
+		if (atomic_test_bit(&dpm_data->ps_ready, HEATER_READY_BIT)) {
+			tip_set_supply_limit(5000, 0);
+		}
+		break;
 	case TRANSITION_PS:
 		atomic_set_bit(&dpm_data->ps_ready, 0);
+		// 合约生效，直接切换到协商的功率，预热过程不中断
+		if (atomic_test_bit(&dpm_data->ps_ready, HEATER_READY_BIT)) {
+			tip_set_supply_limit(pd_get_requested_voltage(dpm_data),
+					     dpm_data->req_current_ma);
+		}
 		break;
 	case PD_CONNECTED:
 		break;
@@ -145,15 +201,19 @@ static void port0_notify(const struct device *dev, const enum usbc_policy_notify
 		break;
 	case POWER_CHANGE_0A0:
 		LOG_INF("PWR 0A");
+		typec_power_change(dpm_data, 0);
 		break;
 	case POWER_CHANGE_DEF:
 		LOG_INF("PWR DEF");
+		typec_power_change(dpm_data, TYPEC_DEFAULT_CURRENT_MA);
 		break;
 	case POWER_CHANGE_1A5:
 		LOG_INF("PWR 1A5");
+		typec_power_change(dpm_data, 1500);
 		break;
 	case POWER_CHANGE_3A0:
 		LOG_INF("PWR 3A0");
+		typec_power_change(dpm_data, 3000);
 		break;
 	case DATA_ROLE_IS_UFP:
 		break;
@@ -163,6 +223,9 @@ static void port0_notify(const struct device *dev, const enum usbc_policy_notify
 		LOG_INF("Port Partner not PD Capable");
 		break;
 	case SNK_TRANSITION_TO_DEFAULT:
+		// 硬复位后合约失效，回到type-c默认电流
+		atomic_clear_bit(&dpm_data->ps_ready, 0);
+		typec_power_change(dpm_data, dpm_data->typec_current_ma);
 		break;
 	case HARD_RESET_RECEIVED:
 		break;
@@ -225,6 +288,8 @@ void pd_start(struct app *app)
 	/* Set Application port data object. This object is passed to the policy
 	 * callbacks */
 	port0_data.ps_ready = ATOMIC_INIT(0);
+	// 控制器还没启动，先按标称电阻选择档位
+	port0_data.heater_mohm = CONFIG_TIP_HEATER_RESISTANCE_MOHM;
 	usbc_set_dpm_data(usbc_port0, &port0_data);
 	/* usbc.rst user data end */
 
@@ -236,6 +301,33 @@ void pd_start(struct app *app)
 	app->pd_data = &port0_data;
 }
 
+void pd_attach_heater(uint32_t heater_mohm)
+{
+	port0_data.heater_mohm = heater_mohm;
+	atomic_set_bit(&port0_data.ps_ready, HEATER_READY_BIT);
+
+	// 已经按标称电阻请求过档位时，用测得的电阻重新排序，
+	// 最佳档位或电流变化时重新获取电源能力，在set_src_cap回调中发出新的请求
+	if (port0_data.src_cap_cnt > 0) {
+		uint16_t ma;
+		uint32_t mw;
+		uint8_t idx = pdo_select(&port0_data, &ma, &mw);
+
+		if (idx != port0_data.req_idx || ma != port0_data.req_current_ma) {
+			LOG_INF("Heater %u mOhm, re-request PDO %d", heater_mohm, idx + 1);
+			usbc_request(usbc_port0, REQUEST_PE_GET_SRC_CAPS);
+		}
+	}
+
+	// 控制器启动前可能已经收到电源通知，补上对应的限制
+	if (atomic_test_bit(&port0_data.ps_ready, 0)) {
+		tip_set_supply_limit(pd_get_requested_voltage(&port0_data),
+				     port0_data.req_current_ma);
+	} else {
+		typec_power_change(&port0_data, port0_data.typec_current_ma);
+	}
+}
+
 bool check_pd_ready(const struct port0_data_t *data)
 {
 	return atomic_test_bit(&data->ps_ready, 0);
@@ -31,7 +31,13 @@ struct port0_data_t {
 	/** Number of Source Capabilities */
 	int src_cap_cnt;
     uint8_t req_idx;
-	/* Power Supply Ready flag */
+	/** Operating current requested from the selected PDO (mA) */
+	uint16_t req_current_ma;
+	/** Type-C Rp current advertisement before a contract (mA) */
+	uint16_t typec_current_ma;
+	/** Heater resistance used to rank PDOs, 0 if unknown (mOhm) */
+	uint32_t heater_mohm;
+	/* Power Supply Ready flag (bit 0), heater controller attached (bit 1) */
 	atomic_t ps_ready;
 };
 
@@ -41,6 +47,9 @@ struct app;
 
 void pd_start(struct app *app);
 
+// 控制环路启动后调用，更新电阻并应用已收到的电源限制
+void pd_attach_heater(uint32_t heater_mohm);
+
 bool check_pd_ready(const struct port0_data_t *data);
 
 uint16_t pd_get_requested_voltage(const struct port0_data_t *data);
@@ -0,0 +1,318 @@
+#define DT_DRV_COMPAT mao_vbus_adc_awd
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/irq.h>
+#include <zephyr/drivers/usb_c/usbc_pd.h>
+#include <zephyr/drivers/usb_c/usbc_tc.h>
+#include <zephyr/drivers/usb_c/usbc_vbus.h>
+#include <zephyr/logging/log.h>
+#include <stm32_ll_adc.h>
+#include <stm32_ll_tim.h>
+
+#include "heater_controller.h"
+#include "service.h"
+#include "vbus_monitor.h"
+
+LOG_MODULE_REGISTER(vbus_monitor, LOG_LEVEL_INF);
+
+#define VBUS_NODE        DT_DRV_INST(0)
+#define ADC_NODE         DT_IO_CHANNELS_CTLR(VBUS_NODE)
+#define ADC_CHANNEL      __LL_ADC_DECIMAL_NB_TO_CHANNEL(DT_IO_CHANNELS_INPUT(VBUS_NODE))
+#define ADC_VREF_MV      DT_PROP(ADC_NODE, vref_mv)
+#define ADC_MAX_RAW      4095
+#define VBUS_FULL_OHMS   DT_INST_PROP(0, full_ohms)
+#define VBUS_OUTPUT_OHMS DT_INST_PROP(0, output_ohms)
+
+// 分压电阻的输出阻抗约3.2k，采样时间要足够长
+#define VBUS_SAMPLING_TIME LL_ADC_SAMPLINGTIME_47CYCLES_5
+
+// 注入通道的触发源固定为tim2 trgo
+#define PWM_TIMER_NODE DT_PARENT(DT_PWMS_CTLR(DT_NODELABEL(solder_heater)))
+
+BUILD_ASSERT(DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT) == 1, "only one vbus monitor supported");
+BUILD_ASSERT(DT_REG_ADDR(PWM_TIMER_NODE) == TIM2_BASE, "heater pwm must use tim2");
+
+static ADC_TypeDef *const adc = (ADC_TypeDef *)DT_REG_ADDR(ADC_NODE);
+static TIM_TypeDef *const pwm_timer = (TIM_TypeDef *)DT_REG_ADDR(PWM_TIMER_NODE);
+
+static bool started;
+
+static uint16_t raw_to_mv(uint32_t raw)
+{
+	return (uint64_t)raw * ADC_VREF_MV * VBUS_FULL_OHMS /
+	       ((uint64_t)(ADC_MAX_RAW + 1) * VBUS_OUTPUT_OHMS);
+}
+
+static uint32_t inject_raw(void)
+{
+	return LL_ADC_INJ_ReadConversionData12(adc, LL_ADC_INJ_RANK_1);
+}
+
+// zephyr的adc驱动每次转换后关闭adc，挂起时还会进入深度掉电，需要时重新上电校准
+static void adc_power_up(void)
+{
+	if (LL_ADC_IsDeepPowerDownEnabled(adc)) {
+		LL_ADC_DisableDeepPowerDown(adc);
+	}
+	if (!LL_ADC_IsInternalRegulatorEnabled(adc)) {
+		LL_ADC_EnableInternalRegulator(adc);
+		k_busy_wait(LL_ADC_DELAY_INTERNAL_REGUL_STAB_US);
+		LL_ADC_StartCalibration(adc, LL_ADC_SINGLE_ENDED);
+		while (LL_ADC_IsCalibrationOnGoing(adc)) {
+		}
+		// 校准结束后至少4个adc时钟才能使能
+		k_busy_wait(1);
+	}
+	if (!LL_ADC_IsEnabled(adc)) {
+		LL_ADC_ClearFlag_ADRDY(adc);
+		LL_ADC_Enable(adc);
+		while (!LL_ADC_IsActiveFlag_ADRDY(adc)) {
+		}
+	}
+}
+
+#if defined(CONFIG_VBUS_BROWNOUT_GUARD)
+enum vbus_state {
+	VBUS_NORMAL,
+	VBUS_DIP,     // 电压跌落，加热已关断
+	VBUS_RESTORE, // 电压已恢复，逐渐放开占空比
+};
+
+struct vbus_dip {
+	uint32_t count;
+	uint32_t ms;
+	uint16_t min_mv;
+	uint32_t duty_q16; // 跌落时的占空比
+};
+
+static enum vbus_state state;
+static uint16_t nominal_mv;
+static uint32_t sag_raw;
+static uint32_t restore_raw;
+// 控制环路最近一次输出的占空比
+static uint32_t applied_q16;
+static uint32_t limit_q16;
+static uint32_t dip_start_cyc;
+static uint32_t dip_min_raw;
+static struct vbus_dip dip;
+static struct vbus_dip last_dip;
+
+static uint32_t mv_to_raw(uint32_t mv)
+{
+	uint64_t raw = (uint64_t)mv * VBUS_OUTPUT_OHMS * (ADC_MAX_RAW + 1) /
+		       ((uint64_t)VBUS_FULL_OHMS * ADC_VREF_MV);
+
+	return MIN(raw, ADC_MAX_RAW);
+}
+
+// 转换结果在[low, high]之外时触发，阈值从下一次转换开始生效
+static void awd_set_window(uint32_t low, uint32_t high)
+{
+	LL_ADC_ConfigAnalogWDThresholds(adc, LL_ADC_AWD1, high, low);
+}
+
+static void dip_log_handler(struct service_job *job)
+{
+	struct vbus_dip d;
+	unsigned int key = irq_lock();
+
+	d = last_dip;
+	irq_unlock(key);
+	LOG_WRN("VBUS dip #%u: min %u mV of %u mV for %u ms at duty %u%%", d.count, d.min_mv,
+		nominal_mv, d.ms, d.duty_q16 * 100 / DUTY_Q16_ONE);
+}
+
+static struct service_job dip_log_job = SERVICE_JOB_INITIALIZER("vbus dip", dip_log_handler);
+
+static void vbus_awd_isr(const void *arg)
+{
+	ARG_UNUSED(arg);
+
+	// 和adc2共用中断
+	if (!LL_ADC_IsEnabledIT_AWD1(adc) || !LL_ADC_IsActiveFlag_AWD1(adc)) {
+		return;
+	}
+	LL_ADC_ClearFlag_AWD1(adc);
+	uint32_t raw = inject_raw();
+
+	if (state != VBUS_DIP) {
+		// 不等pwm周期结束，输出立即变为无效电平，比较值清零，恢复时不会按原占空比输出
+		soldering_tip_pwm_force_off(true);
+		heater_off();
+		state = VBUS_DIP;
+		dip.duty_q16 = applied_q16;
+		dip_min_raw = raw;
+		dip_start_cyc = k_cycle_get_32();
+		awd_set_window(0, restore_raw);
+		return;
+	}
+
+	dip.count++;
+	dip.ms = k_cyc_to_ms_ceil32(k_cycle_get_32() - dip_start_cyc);
+	dip.min_mv = raw_to_mv(dip_min_raw);
+	last_dip = dip;
+	// 从跌落前一半的占空比开始恢复，反复跌落时每次减半
+	limit_q16 = dip.duty_q16 / 2;
+	state = VBUS_RESTORE;
+	awd_set_window(sag_raw, ADC_MAX_RAW);
+	soldering_tip_pwm_force_off(false);
+	service_kick(&dip_log_job);
+}
+
+void vbus_monitor_set_nominal(uint16_t mv)
+{
+	unsigned int key = irq_lock();
+
+	nominal_mv = mv;
+	sag_raw = mv ? mv_to_raw((uint32_t)mv * CONFIG_VBUS_SAG_PERCENT / 100) : 0;
+	restore_raw = mv ? mv_to_raw((uint32_t)mv * CONFIG_VBUS_RESTORE_PERCENT / 100) : 0;
+	if (state == VBUS_DIP) {
+		awd_set_window(0, restore_raw);
+	} else {
+		awd_set_window(sag_raw, ADC_MAX_RAW);
+	}
+	irq_unlock(key);
+}
+
+uint32_t vbus_monitor_limit_duty(uint32_t duty_q16, uint16_t elapsed_ms)
+{
+	switch (state) {
+	case VBUS_DIP:
+		dip_min_raw = MIN(dip_min_raw, inject_raw());
+		duty_q16 = 0;
+		break;
+	case VBUS_RESTORE:
+		limit_q16 += MAX_DUTY_Q16 * elapsed_ms / CONFIG_VBUS_RESTORE_MS;
+		if (limit_q16 >= MAX_DUTY_Q16) {
+			state = VBUS_NORMAL;
+		} else {
+			duty_q16 = MIN(duty_q16, limit_q16);
+		}
+		break;
+	default:
+		break;
+	}
+	applied_q16 = duty_q16;
+	return duty_q16;
+}
+#endif
+
+int vbus_monitor_start(void)
+{
+	// 每个pwm周期开始时触发一次注入转换
+	LL_TIM_SetTriggerOutput(pwm_timer, LL_TIM_TRGO_UPDATE);
+	adc_power_up();
+#if defined(CONFIG_VBUS_BROWNOUT_GUARD)
+	LL_ADC_ClearFlag_AWD1(adc);
+	LL_ADC_EnableIT_AWD1(adc);
+	irq_enable(DT_IRQN(ADC_NODE));
+#endif
+	LL_ADC_INJ_StartConversion(adc);
+	started = true;
+	return 0;
+}
+
+int vbus_monitor_read_mv(uint16_t *mv)
+{
+	if (!started) {
+		return -EAGAIN;
+	}
+	*mv = raw_to_mv(inject_raw());
+	return 0;
+}
+
+void vbus_monitor_pause(void)
+{
+	if (!started) {
+		return;
+	}
+	if (LL_ADC_INJ_IsConversionOngoing(adc)) {
+		LL_ADC_INJ_StopConversion(adc);
+		while (LL_ADC_INJ_IsStopConversionOngoing(adc)) {
+		}
+	}
+}
+
+void vbus_monitor_resume(void)
+{
+	if (!started) {
+		return;
+	}
+	adc_power_up();
+	LL_ADC_INJ_StartConversion(adc);
+}
+
+// type-c协议栈使用的vbus驱动接口
+static int vbus_measure(const struct device *dev, int *meas)
+{
+	uint16_t mv;
+	int ret = vbus_monitor_read_mv(&mv);
+
+	if (ret == 0) {
+		*meas = mv;
+	}
+	return ret;
+}
+
+static bool vbus_check_level(const struct device *dev, enum tc_vbus_level level)
+{
+	int mv;
+
+	if (vbus_measure(dev, &mv) != 0) {
+		return false;
+	}
+	switch (level) {
+	case TC_VBUS_SAFE0V:
+		return mv < PD_V_SAFE_0V_MAX_MV;
+	case TC_VBUS_PRESENT:
+		return mv >= PD_V_SAFE_5V_MIN_MV;
+	case TC_VBUS_REMOVED:
+		return mv < TC_V_SINK_DISCONNECT_MAX_MV;
+	}
+	return false;
+}
+
+// 板子上没有vbus放电和开关电路
+static int vbus_discharge(const struct device *dev, bool enable)
+{
+	return -ENOENT;
+}
+
+static int vbus_enable(const struct device *dev, bool enable)
+{
+	return -ENOENT;
+}
+
+static const struct usbc_vbus_driver_api vbus_api = {
+	.check_level = vbus_check_level,
+	.measure = vbus_measure,
+	.discharge = vbus_discharge,
+	.enable = vbus_enable,
+};
+
+static int vbus_monitor_init(const struct device *dev)
+{
+	// 时钟、公共配置和引脚由zephyr的adc驱动完成，初始化后adc处于关闭状态，可以修改配置
+	if (!device_is_ready(DEVICE_DT_GET(ADC_NODE))) {
+		return -ENODEV;
+	}
+	LL_ADC_SetChannelSamplingTime(adc, ADC_CHANNEL, VBUS_SAMPLING_TIME);
+	LL_ADC_INJ_ConfigQueueContext(adc, LL_ADC_INJ_TRIG_EXT_TIM2_TRGO,
+				      LL_ADC_INJ_TRIG_EXT_RISING, LL_ADC_INJ_SEQ_SCAN_DISABLE,
+				      ADC_CHANNEL, ADC_CHANNEL, ADC_CHANNEL, ADC_CHANNEL);
+#if defined(CONFIG_VBUS_BROWNOUT_GUARD)
+	LL_ADC_SetAnalogWDMonitChannels(
+		adc, LL_ADC_AWD1, __LL_ADC_ANALOGWD_CHANNEL_GROUP(ADC_CHANNEL, LL_ADC_GROUP_INJECTED));
+	// 连续两次超出阈值才触发，滤掉单次的尖峰
+	LL_ADC_SetAWDFilteringConfiguration(adc, LL_ADC_AWD1, LL_ADC_AWD_FILTERING_2SAMPLES);
+	// 协商电压前不检测
+	awd_set_window(0, ADC_MAX_RAW);
+	IRQ_CONNECT(DT_IRQN(ADC_NODE), DT_IRQ(ADC_NODE, priority), vbus_awd_isr, NULL, 0);
+#endif
+	return 0;
+}
+
+DEVICE_DT_INST_DEFINE(0, vbus_monitor_init, NULL, NULL, NULL, POST_KERNEL,
+		      CONFIG_VBUS_MONITOR_INIT_PRIORITY, &vbus_api);
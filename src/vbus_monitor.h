@@ -0,0 +1,44 @@
+#ifndef __VBUS_MONITOR_H
+#define __VBUS_MONITOR_H
+
+#include <stdint.h>
+
+/*
+ * vbus电压监测：adc1的注入通道由加热pwm定时器（tim2）的更新事件触发，每个pwm周期采样一次，
+ * 同时作为type-c协议栈的vbus驱动。
+ * 开启CONFIG_VBUS_BROWNOUT_GUARD时用模拟看门狗检测电压跌落，在中断里立即关断加热，
+ * 电压恢复后从跌落前一半的占空比逐渐恢复。
+ * adc1的规则通道仍由zephyr的adc驱动使用（芯片温度），驱动每次转换后会关闭adc，
+ * 读取前后需要调用vbus_monitor_pause/resume。
+ */
+
+/**
+ * @brief 开始采样，type-c协议栈启动前调用
+ */
+int vbus_monitor_start(void);
+
+/**
+ * @brief 最近一次测得的vbus电压
+ */
+int vbus_monitor_read_mv(uint16_t *mv);
+
+/**
+ * @brief adc1的规则通道转换前停止注入通道，转换后恢复
+ */
+void vbus_monitor_pause(void);
+void vbus_monitor_resume(void);
+
+#if defined(CONFIG_VBUS_BROWNOUT_GUARD)
+/**
+ * @brief 设置协商的电源电压，按比例计算跌落和恢复阈值，mv为0时不检测
+ */
+void vbus_monitor_set_nominal(uint16_t mv);
+
+/**
+ * @brief 控制环路每次采样调用，跌落期间返回0，恢复时逐渐放开限制
+ * 调用方锁中断，直到按返回的占空比设置完pwm，避免和掉电中断交错
+ */
+uint32_t vbus_monitor_limit_duty(uint32_t duty_q16, uint16_t elapsed_ms);
+#endif
+
+#endif // __VBUS_MONITOR_H